@@ -129,7 +129,7 @@ void register_check_option(const std::string& name,
                            const std::function<void(bool)>& change_handler) {
     s_options[name] = Option {
         default_value,
-        [=](const OptionValue& v) { change_handler(std::get<std::int64_t>(v)); },
+        [=](const OptionValue& v) { change_handler(std::get<bool>(v)); },
         default_value,
     };
 }
@@ -251,6 +251,7 @@ void register_go(const std::function<void(const GoArgs&)>& handler) {
                 if (!go_args.infinite) {
                     throw InputError("Unexpected infinite to go when limits were specified.");
                 }
+                word = reader.read_word();
                 continue;
             }
             go_args.infinite = false;
@@ -583,7 +584,7 @@ void WorkThread::submit_task(Task new_task) {
 }
 
 void WorkThread::stop_current_task() {
-    m_stop.store(true, std::memory_order_acquire);
+    m_stop.store(true, std::memory_order_release);
 }
 
 WorkThread::WorkThread()
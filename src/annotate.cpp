@@ -0,0 +1,337 @@
+#include "annotate.h"
+
+#include "fen.h"
+#include "mapped_file.h"
+#include "memory.h"
+#include "pgn.h"
+#include "pipeline.h"
+#include "san.h"
+#include "../ext/libuci/uci.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <utility>
+
+using namespace chess;
+
+// Losses are measured on scores clamped to this, so that missing a mate
+// counts as a large loss rather than a huge one.
+static constexpr int MAX_LOSS_SCORE = 1000;
+
+AnnotateOptions parse_annotate_options(const std::vector<std::string>& words) {
+    AnnotateOptions options {};
+    options.threads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    bool nodes_given = false;
+
+    for (std::size_t i = 0; i < words.size(); i += 2) {
+        const std::string& name = words[i];
+        if (i + 1 >= words.size()) {
+            throw uci::InputError("Missing value for annotate option " + name + ".");
+        }
+        const std::string& value = words[i + 1];
+
+        std::int64_t number;
+        try {
+            std::size_t end = 0;
+            number = std::stoll(value, &end);
+            if (end != value.size() || number < 0) {
+                throw std::invalid_argument(value);
+            }
+        }
+        catch (const std::exception&) {
+            throw uci::InputError("Invalid value for annotate option " + name + ": " + value + ".");
+        }
+
+        if (name == "threads") {
+            options.threads = std::max(int(number), 1);
+        }
+        else if (name == "nodes") {
+            options.limits.nodes = std::uint64_t(number);
+            nodes_given = true;
+        }
+        else if (name == "depth") {
+            options.limits.depth = int(number);
+        }
+        else if (name == "time") {
+            options.limits.time_ms = number;
+        }
+        else if (name == "blunder") {
+            options.blunder_cp = std::max(int(number), 1);
+        }
+        else {
+            throw uci::InputError("Unknown annotate option " + name + ".");
+        }
+    }
+
+    // A depth or time alone replaces the default node limit.
+    if ((options.limits.depth > 0 || options.limits.time_ms > 0) && !nodes_given) {
+        options.limits.nodes = 0;
+    }
+    if (options.limits.depth == 0 && options.limits.nodes == 0 && options.limits.time_ms == 0) {
+        throw uci::InputError("Annotate needs a depth, node or time limit.");
+    }
+    return options;
+}
+
+namespace {
+
+struct PgnGame {
+    std::vector<std::pair<std::string, std::string>> headers;
+    Board start;
+    // A comment before the first move.
+    std::string comment;
+    std::vector<Move> moves;
+    std::vector<std::string> comments;
+    bool truncated = false;
+    // The FEN header couldn't be loaded, so the game is left out.
+    bool invalid_start = false;
+};
+
+struct AnnotatedGame {
+    std::string text;
+    std::uint64_t positions = 0;
+    bool truncated = false;
+    bool skipped = false;
+};
+
+// Collects the games and submits each one to the pipeline once complete.
+class GameReader : public pgn::Visitor {
+public:
+    explicit GameReader(OrderedPipeline<PgnGame, AnnotatedGame>& pipeline)
+        : m_pipeline(pipeline) {}
+
+    void startPgn() override {
+        m_game = PgnGame();
+    }
+
+    void header(std::string_view key, std::string_view value) override {
+        m_game.headers.emplace_back(key, value);
+        if (key == "FEN" && try_parse_fen(m_game.start, value) != FenError::None) {
+            m_game.invalid_start = true;
+            skipPgn(true);
+        }
+    }
+
+    void startMoves() override {
+        m_board = m_game.start;
+    }
+
+    void move(std::string_view san, std::string_view comment) override {
+        if (san.empty()) {
+            m_game.comment = comment;
+            return;
+        }
+        if (m_game.truncated) {
+            return;
+        }
+
+        Move move;
+        if (try_parse_san(m_board, san, move, m_scratch) != SanError::None) {
+            m_game.truncated = true;
+            return;
+        }
+        m_game.moves.push_back(move);
+        m_game.comments.emplace_back(comment);
+        m_board.makeMove(move);
+    }
+
+    void endPgn() override {
+        m_pipeline.submit(std::move(m_game));
+    }
+
+private:
+    OrderedPipeline<PgnGame, AnnotatedGame>& m_pipeline;
+    PgnGame m_game;
+    Board m_board;
+    Movelist m_scratch;
+};
+
+}
+
+// '0.35', '-1.20', '#3' or '#-2', from white's point of view.
+static std::string format_eval(int white_score) {
+    if (std::abs(white_score) >= MATE_BOUND) {
+        int moves = (MATE_SCORE - std::abs(white_score) + 1) / 2;
+        return "#" + std::to_string(white_score > 0 ? moves : -moves);
+    }
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%.2f", white_score / 100.0);
+    return buffer;
+}
+
+// Appends movetext tokens, wrapping lines before 80 characters.
+class MovetextWriter {
+public:
+    explicit MovetextWriter(std::string& out)
+        : m_out(out) {}
+
+    void token(const std::string& token) {
+        if (m_line_length > 0 && m_line_length + 1 + token.size() > 79) {
+            m_out += '\n';
+            m_line_length = 0;
+        }
+        else if (m_line_length > 0) {
+            m_out += ' ';
+            m_line_length++;
+        }
+        m_out += token;
+        m_line_length += token.size();
+    }
+
+private:
+    std::string& m_out;
+    std::size_t m_line_length = 0;
+};
+
+static AnnotatedGame annotate_game(PgnGame& game, FixedSearcher& searcher, const AnnotateOptions& options) {
+    if (game.invalid_start) {
+        AnnotatedGame skipped;
+        skipped.skipped = true;
+        return skipped;
+    }
+    searcher.clear();
+    Board board = game.start;
+    std::size_t count = game.moves.size();
+
+    // Scores are from the side to move's point of view, for every position
+    // including the last one.
+    std::vector<int> scores(count + 1);
+    std::vector<Move> best_moves(count + 1, Move::NO_MOVE);
+    std::vector<std::string> best_sans(count + 1);
+    Movelist moves;
+
+    for (std::size_t i = 0; i <= count; ++i) {
+        movegen::legalmoves(moves, board);
+        if (moves.empty()) {
+            scores[i] = board.inCheck() ? -MATE_SCORE : 0;
+        }
+        else {
+            FixedSearchResult searched = searcher.search(board, options.limits);
+            scores[i] = searched.score;
+            best_moves[i] = searched.best_move;
+            best_sans[i] = chess::uci::moveToSan(board, searched.best_move);
+        }
+        if (i < count) {
+            board.makeMove(game.moves[i]);
+        }
+    }
+
+    AnnotatedGame annotated;
+    annotated.positions = count + 1;
+    annotated.truncated = game.truncated;
+    std::string& out = annotated.text;
+
+    std::string result = "*";
+    for (const auto& [key, value]: game.headers) {
+        out += "[" + key + " \"" + value + "\"]\n";
+        if (key == "Result") {
+            result = value;
+        }
+    }
+    out += '\n';
+
+    MovetextWriter writer(out);
+    if (!game.comment.empty()) {
+        writer.token("{" + game.comment + "}");
+    }
+
+    board = game.start;
+    for (std::size_t i = 0; i < count; ++i) {
+        Move move = game.moves[i];
+        bool white = board.sideToMove() == Color::WHITE;
+        int move_number = board.fullMoveNumber();
+
+        // The loss of the played move against the best one, both seen from
+        // the mover's side: the score before it, and the negated score after.
+        int before = std::clamp(scores[i], -MAX_LOSS_SCORE, MAX_LOSS_SCORE);
+        int after = std::clamp(-scores[i + 1], -MAX_LOSS_SCORE, MAX_LOSS_SCORE);
+        int loss = move == best_moves[i] ? 0 : before - after;
+        const char* flag = loss >= options.blunder_cp ? "??" : loss >= options.blunder_cp / 2 ? "?" : "";
+
+        // Every move is followed by a comment, so black's moves always need
+        // their number.
+        writer.token(std::to_string(move_number) + (white ? "." : "..."));
+        writer.token(chess::uci::moveToSan(board, move) + flag);
+
+        int white_after = white ? -scores[i + 1] : scores[i + 1];
+        std::string comment = "{ [%eval " + format_eval(white_after) + "]";
+        if (*flag) {
+            comment += " Best: " + best_sans[i];
+        }
+        if (!game.comments[i].empty()) {
+            comment += " " + game.comments[i];
+        }
+        writer.token(comment + " }");
+
+        board.makeMove(move);
+    }
+    writer.token(result);
+    out += "\n\n";
+    return annotated;
+}
+
+AnnotateStats annotate_pgn(const std::string& input, const std::string& output, const AnnotateOptions& options) {
+    MappedFile file(input);
+    std::ofstream out(output);
+    if (!out) {
+        throw uci::InputError("Could not open " + output + ".");
+    }
+
+    AnnotateStats stats {};
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        auto now = std::chrono::steady_clock::now();
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+    };
+    std::uint64_t last_report = 0;
+
+    track_memory("annotate tables", options.threads * FixedSearcher::table_bytes_for(DEFAULT_FIXED_SEARCH_TABLE_MB));
+    pgn::StreamParserError error;
+    {
+        // A few games per thread in flight, so a long game doesn't stall the others.
+        OrderedPipeline<PgnGame, AnnotatedGame> pipeline(
+            options.threads, 4 * std::size_t(options.threads),
+            [&]() {
+                return [&, searcher = FixedSearcher()](PgnGame& game) mutable {
+                    return annotate_game(game, searcher, options);
+                };
+            },
+            [&](const AnnotatedGame& game) {
+                if (game.skipped) {
+                    stats.skipped_games++;
+                    return;
+                }
+                out << game.text;
+                stats.games++;
+                stats.positions += game.positions;
+                stats.truncated_games += game.truncated;
+
+                std::uint64_t elapsed = elapsed_ms();
+                if (elapsed - last_report >= 10000) {
+                    last_report = elapsed;
+                    std::cout << "games " << stats.games << " positions " << stats.positions
+                              << " pos/s " << stats.positions * 1000 / std::max<std::uint64_t>(elapsed, 1) << std::endl;
+                }
+            });
+
+        GameReader reader(pipeline);
+        PgnViewParser parser(file.view());
+        error = parser.readGames(reader);
+    }
+    untrack_memory("annotate tables");
+
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Could not write " + output + ".");
+    }
+    if (error) {
+        throw uci::InputError(input + ": invalid PGN after " + std::to_string(stats.games) + " games.");
+    }
+    stats.time_ms = elapsed_ms();
+    return stats;
+}
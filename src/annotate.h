@@ -0,0 +1,44 @@
+#ifndef ANNOTATE_H
+#define ANNOTATE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fixedsearch.h"
+
+struct AnnotateOptions {
+    SearchLimits limits { 0, 100000 };
+    int threads = 1;
+    // Moves losing at least this many centipawns against the best move are
+    // marked '??', and those losing half of it '?'.
+    int blunder_cp = 200;
+};
+
+struct AnnotateStats {
+    std::uint64_t games = 0;
+    std::uint64_t positions = 0;
+    // Games with a move that couldn't be decoded, annotated up to it.
+    std::uint64_t truncated_games = 0;
+    // Games with an invalid FEN header, left out of the output.
+    std::uint64_t skipped_games = 0;
+    std::uint64_t time_ms = 0;
+};
+
+// Parses 'name value' pairs, such as 'nodes 100000 threads 8', into the
+// options: threads, nodes, depth, time (ms) and blunder (cp). Throws
+// uci::InputError on unknown names or invalid values.
+AnnotateOptions parse_annotate_options(const std::vector<std::string>& words);
+
+// Searches every position of every game of the input PGN and writes the
+// games to the output PGN with an '[%eval]' comment after each move (from
+// white's point of view, in pawns) and the best move after bad ones.
+//
+// Games are searched in parallel, one game per thread at a time, and
+// written in input order. Each thread keeps its transposition table
+// between the positions of a game, which share most of their subtrees, and
+// clears it between games so that the output doesn't depend on the thread
+// count when searching to a depth or node limit.
+AnnotateStats annotate_pgn(const std::string& input, const std::string& output, const AnnotateOptions& options);
+
+#endif //ANNOTATE_H
@@ -0,0 +1,215 @@
+#include "bench.h"
+
+#include "memory.h"
+#include "numa.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+const std::vector<std::string> BENCH_FENS = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1BBPPP/R2QK2R w KQ - 3 9",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/8/1p4p1/p1p2k1p/P2n1P1P/4K1P1/8/8 b - - 0 1",
+};
+
+std::uint64_t BenchResult::nps() const {
+    return nodes * 1000 / std::max<std::uint64_t>(time_ms, 1);
+}
+
+std::uint64_t bench_position(FixedSearcher& searcher, const std::string& fen, int depth) {
+    chess::Board board(fen);
+    SearchLimits limits {};
+    limits.depth = depth;
+    searcher.clear();
+    return searcher.search(board, limits).nodes;
+}
+
+BenchResult run_bench(int depth) {
+    BenchResult result {};
+    FixedSearcher searcher;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& fen: BENCH_FENS) {
+        result.nodes += bench_position(searcher, fen, depth);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    result.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    return result;
+}
+
+PerftTable::PerftTable(std::size_t size_mb, bool use_hugetlb) {
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= size_mb * 1024 * 1024) {
+        count *= 2;
+    }
+    m_memory = HugePageBuffer(count * sizeof(Entry), use_hugetlb);
+    m_entries = static_cast<Entry*>(m_memory.data());
+    std::uninitialized_default_construct_n(m_entries, count);
+    m_mask = count - 1;
+    // Also the first touch of the pages, so that they are committed here
+    // rather than during the first search.
+    clear();
+    track_memory("perft table", count * sizeof(Entry), m_memory.backing());
+}
+
+PerftTable::~PerftTable() {
+    untrack_memory("perft table");
+}
+
+// Data layout: depth in the low 8 bits, node count in the remaining 56.
+std::optional<std::uint64_t> PerftTable::probe(std::uint64_t key, int depth) const {
+    const Entry& entry = m_entries[key & m_mask];
+    std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+    std::uint64_t key_xor_data = entry.key_xor_data.load(std::memory_order_relaxed);
+
+    if ((key_xor_data ^ data) != key || int(data & 0xFF) != depth) {
+        return std::nullopt;
+    }
+    return data >> 8;
+}
+
+void PerftTable::store(std::uint64_t key, int depth, std::uint64_t nodes) {
+    Entry& entry = m_entries[key & m_mask];
+    std::uint64_t data = (nodes << 8) | std::uint64_t(depth);
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+}
+
+void PerftTable::clear() {
+    for (std::uint64_t i = 0; i <= m_mask; ++i) {
+        m_entries[i].data.store(0, std::memory_order_relaxed);
+        m_entries[i].key_xor_data.store(0, std::memory_order_relaxed);
+    }
+}
+
+static std::uint64_t hashed_perft(chess::Board& board, int depth, PerftTable& table, PerftStats& stats) {
+    if (depth >= 2) {
+        stats.tt_probes++;
+        if (auto nodes = table.probe(board.hash(), depth)) {
+            stats.tt_hits++;
+            return *nodes;
+        }
+    }
+
+    stats.visited++;
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+
+    if (depth <= 1) {
+        return depth == 1 ? moves.size() : 1;
+    }
+
+    std::uint64_t nodes = 0;
+    for (const chess::Move& move: moves) {
+        board.makeMove(move);
+        std::uint64_t child_nodes = hashed_perft(board, depth - 1, table, stats);
+        TRACE_NODE(board.hash(), depth - 1, 0, 0, move.move(), std::int64_t(child_nodes));
+        board.unmakeMove(move);
+        nodes += child_nodes;
+    }
+
+    table.store(board.hash(), depth, nodes);
+    return nodes;
+}
+
+// Splits the perft of a position into one task per two-ply move sequence,
+// which are then picked up by the worker threads.
+static void parallel_perft(const chess::Board& root, int depth, int threads,
+                           PerftTable& table, std::vector<PerftStats>& stats) {
+    std::vector<std::pair<chess::Move, chess::Move>> tasks;
+    chess::Board board = root;
+    chess::Movelist moves;
+    chess::Movelist replies;
+
+    if (depth >= 3) {
+        chess::movegen::legalmoves(moves, board);
+        for (const chess::Move& move: moves) {
+            board.makeMove(move);
+            chess::movegen::legalmoves(replies, board);
+            for (const chess::Move& reply: replies) {
+                tasks.emplace_back(move, reply);
+            }
+            board.unmakeMove(move);
+        }
+    }
+
+    std::atomic<std::size_t> next_task = 0;
+    auto worker = [&](int index, PerftStats& thread_stats) {
+        ThreadPin pin(index);
+        chess::Board thread_board = root;
+        if (depth < 3) {
+            if (next_task.fetch_add(1) == 0) {
+                hashed_perft(thread_board, depth, table, thread_stats);
+            }
+            return;
+        }
+
+        std::size_t i;
+        while ((i = next_task.fetch_add(1)) < tasks.size()) {
+            thread_board.makeMove(tasks[i].first);
+            thread_board.makeMove(tasks[i].second);
+            hashed_perft(thread_board, depth - 2, table, thread_stats);
+            thread_board.unmakeMove(tasks[i].second);
+            thread_board.unmakeMove(tasks[i].first);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker, i, std::ref(stats[i]));
+    }
+    worker(0, stats[0]);
+    for (std::thread& t: workers) {
+        t.join();
+    }
+}
+
+std::vector<ScalingResult> run_scaling_bench(int depth, int max_threads, PerftTable& table) {
+    std::vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::vector<ScalingResult> results;
+
+    for (int threads: thread_counts) {
+        table.clear();
+        std::vector<PerftStats> stats(threads);
+
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& fen: BENCH_FENS) {
+            parallel_perft(chess::Board(fen), depth, threads, table, stats);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        ScalingResult result {};
+        result.threads = threads;
+        result.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        for (const PerftStats& s: stats) {
+            result.stats.visited += s.visited;
+            result.stats.tt_probes += s.tt_probes;
+            result.stats.tt_hits += s.tt_hits;
+        }
+        results.push_back(result);
+    }
+
+    return results;
+}
@@ -0,0 +1,81 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "fixedsearch.h"
+#include "memory.h"
+
+// Positions used by 'bench'. Since the bench node count doubles as a
+// signature for the engine, changing this list changes the signature.
+extern const std::vector<std::string> BENCH_FENS;
+
+constexpr int DEFAULT_BENCH_DEPTH = 5;
+constexpr int DEFAULT_SCALING_DEPTH = 5;
+
+struct BenchResult {
+    std::uint64_t nodes = 0;
+    std::uint64_t time_ms = 0;
+
+    [[nodiscard]] std::uint64_t nps() const;
+};
+
+// Searches a bench position to the given depth with FixedSearcher, cleared
+// first so that the node count doesn't depend on the positions before it,
+// and returns the node count.
+std::uint64_t bench_position(FixedSearcher& searcher, const std::string& fen, int depth);
+
+// Searches every bench position and accumulates the node counts and time
+// spent.
+BenchResult run_bench(int depth = DEFAULT_BENCH_DEPTH);
+
+// Perft hash table, shared between threads without locking. Entries
+// store their key xor'ed with their data so that torn writes are
+// detected as misses. The entries live in a HugePageBuffer, see
+// memory.h for use_hugetlb.
+class PerftTable {
+public:
+    explicit PerftTable(std::size_t size_mb, bool use_hugetlb = false);
+    ~PerftTable();
+
+    [[nodiscard]] std::size_t size_bytes() const { return m_memory.size(); }
+    [[nodiscard]] PageBacking backing() const { return m_memory.backing(); }
+
+    [[nodiscard]] std::optional<std::uint64_t> probe(std::uint64_t key, int depth) const;
+    void store(std::uint64_t key, int depth, std::uint64_t nodes);
+    void clear();
+
+private:
+    struct Entry {
+        std::atomic<std::uint64_t> key_xor_data;
+        std::atomic<std::uint64_t> data;
+    };
+
+    HugePageBuffer m_memory;
+    Entry* m_entries;
+    std::uint64_t m_mask;
+};
+
+// Counters of a single perft worker.
+struct PerftStats {
+    std::uint64_t visited = 0;
+    std::uint64_t tt_probes = 0;
+    std::uint64_t tt_hits = 0;
+};
+
+struct ScalingResult {
+    int threads = 0;
+    std::uint64_t time_ms = 0;
+    PerftStats stats {};
+};
+
+// Runs the bench suite with a hashed perft split across 1, 2, 4 ... max_threads
+// threads, all sharing the given table. The table is cleared before each run.
+std::vector<ScalingResult> run_scaling_bench(int depth, int max_threads, PerftTable& table);
+
+#endif //BENCH_H
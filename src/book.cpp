@@ -0,0 +1,146 @@
+#include "book.h"
+
+#include "memory.h"
+#include "../ext/libuci/uci.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+PolyglotEntry read_polyglot_entry(const char* data) {
+    auto read = [&](int offset, int size) {
+        std::uint64_t value = 0;
+        for (int i = 0; i < size; ++i) {
+            value = (value << 8) | static_cast<unsigned char>(data[offset + i]);
+        }
+        return value;
+    };
+    return {
+        read(0, 8),
+        std::uint16_t(read(8, 2)),
+        std::uint16_t(read(10, 2)),
+        std::uint32_t(read(12, 4)),
+    };
+}
+
+void write_polyglot_entry(const PolyglotEntry& entry, char* data) {
+    auto write = [&](int offset, int size, std::uint64_t value) {
+        for (int i = size - 1; i >= 0; --i) {
+            data[offset + i] = char(value & 0xFF);
+            value >>= 8;
+        }
+    };
+    write(0, 8, entry.key);
+    write(8, 2, entry.move);
+    write(10, 2, entry.weight);
+    write(12, 4, entry.learn);
+}
+
+// Bits 0-5: to square, 6-11: from square, 12-14: promotion piece (1 = knight ... 4 = queen).
+std::uint16_t to_polyglot_move(chess::Move move) {
+    int promotion = move.typeOf() == chess::Move::PROMOTION ? int(move.promotionType()) : 0;
+    return std::uint16_t(move.to().index() | move.from().index() << 6 | promotion << 12);
+}
+
+std::optional<chess::Move> from_polyglot_move(const chess::Board& board, std::uint16_t move) {
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+    for (const chess::Move& m: moves) {
+        if (to_polyglot_move(m) == move) {
+            return m;
+        }
+    }
+    return std::nullopt;
+}
+
+void Book::open(const std::string& path) {
+    close();
+    if (path.empty()) {
+        return;
+    }
+
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(path, MappedFile::Access::Random);
+    }
+    catch (const std::runtime_error& e) {
+        throw uci::InputError(e.what());
+    }
+    if (file->size() % POLYGLOT_ENTRY_SIZE != 0) {
+        throw uci::InputError(path + " is not a Polyglot book.");
+    }
+
+    m_count = file->size() / POLYGLOT_ENTRY_SIZE;
+    m_file = std::move(file);
+    track_memory("book", m_file->size());
+}
+
+void Book::close() {
+    m_file.reset();
+    m_count = 0;
+    untrack_memory("book");
+}
+
+bool Book::loaded() const {
+    return m_file != nullptr;
+}
+
+std::vector<PolyglotEntry> Book::entries(std::uint64_t key) const {
+    std::vector<PolyglotEntry> found;
+    if (!m_file) {
+        return found;
+    }
+
+    // Lower bound of the key. Only the key of each probed entry is decoded.
+    const char* data = m_file->data();
+    auto key_at = [&](std::size_t i) { return read_polyglot_entry(data + i * POLYGLOT_ENTRY_SIZE).key; };
+
+    std::size_t low = 0;
+    std::size_t high = m_count;
+    while (low < high) {
+        std::size_t mid = low + (high - low) / 2;
+        if (key_at(mid) < key) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    for (std::size_t i = low; i < m_count; ++i) {
+        PolyglotEntry entry = read_polyglot_entry(data + i * POLYGLOT_ENTRY_SIZE);
+        if (entry.key != key) {
+            break;
+        }
+        found.push_back(entry);
+    }
+    return found;
+}
+
+std::optional<chess::Move> Book::probe(const chess::Board& board, bool best) {
+    std::vector<std::pair<chess::Move, std::uint16_t>> candidates;
+    std::uint64_t total_weight = 0;
+    for (const PolyglotEntry& entry: entries(board.hash())) {
+        if (auto move = from_polyglot_move(board, entry.move)) {
+            candidates.emplace_back(*move, entry.weight);
+            total_weight += entry.weight;
+        }
+    }
+    if (candidates.empty()) {
+        return std::nullopt;
+    }
+
+    if (best || total_weight == 0) {
+        return std::max_element(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a.second < b.second;
+        })->first;
+    }
+
+    std::uint64_t pick = std::uniform_int_distribution<std::uint64_t>(0, total_weight - 1)(m_rng);
+    for (const auto& [move, weight]: candidates) {
+        if (pick < weight) {
+            return move;
+        }
+        pick -= weight;
+    }
+    return candidates.back().first;
+}
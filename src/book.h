@@ -0,0 +1,58 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "mapped_file.h"
+
+// A Polyglot book entry. Entries are 16 bytes, stored big-endian
+// and sorted by key. chess::Board::hash() is the Polyglot key.
+struct PolyglotEntry {
+    std::uint64_t key;
+    std::uint16_t move;
+    std::uint16_t weight;
+    std::uint32_t learn;
+};
+
+constexpr std::size_t POLYGLOT_ENTRY_SIZE = 16;
+
+PolyglotEntry read_polyglot_entry(const char* data);
+void write_polyglot_entry(const PolyglotEntry& entry, char* data);
+
+// Polyglot moves use from/to squares and a promotion piece. Castling is
+// encoded as the king moving to its rook, as chess::Move does it too.
+std::uint16_t to_polyglot_move(chess::Move move);
+
+// The legal move a Polyglot move stands for in the given position, if any.
+std::optional<chess::Move> from_polyglot_move(const chess::Board& board, std::uint16_t move);
+
+// A memory-mapped Polyglot book, probed by binary search.
+class Book {
+public:
+    // Maps the given book file. An empty path closes the current book.
+    // Throws uci::InputError if the file is not a valid book.
+    void open(const std::string& path);
+    void close();
+    [[nodiscard]] bool loaded() const;
+
+    // All entries of a position, in file order.
+    [[nodiscard]] std::vector<PolyglotEntry> entries(std::uint64_t key) const;
+
+    // Picks a book move for the position: the one with the highest weight
+    // if best is set, otherwise a random one, chosen in proportion to the
+    // weights. Book moves that aren't legal in the position are ignored.
+    std::optional<chess::Move> probe(const chess::Board& board, bool best);
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    std::size_t m_count = 0;
+    std::mt19937_64 m_rng { std::random_device {}() };
+};
+
+#endif //BOOK_H
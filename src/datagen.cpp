@@ -0,0 +1,262 @@
+#include "datagen.h"
+
+#include "memory.h"
+#include "numa.h"
+#include "trainingdata.h"
+#include "../ext/libuci/uci.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+using namespace chess;
+
+DatagenOptions parse_datagen_options(const std::vector<std::string>& words) {
+    DatagenOptions options {};
+    options.threads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    bool nodes_given = false;
+
+    for (std::size_t i = 0; i < words.size(); i += 2) {
+        const std::string& name = words[i];
+        if (i + 1 >= words.size()) {
+            throw uci::InputError("Missing value for datagen option " + name + ".");
+        }
+        const std::string& value = words[i + 1];
+        if (name == "output") {
+            options.output = value;
+            continue;
+        }
+
+        std::int64_t number;
+        try {
+            std::size_t end = 0;
+            number = std::stoll(value, &end);
+            if (end != value.size() || number < 0) {
+                throw std::invalid_argument(value);
+            }
+        }
+        catch (const std::exception&) {
+            throw uci::InputError("Invalid value for datagen option " + name + ": " + value + ".");
+        }
+
+        if (name == "games") {
+            options.games = std::uint64_t(number);
+        }
+        else if (name == "threads") {
+            options.threads = std::max(int(number), 1);
+        }
+        else if (name == "seed") {
+            options.seed = std::uint64_t(number);
+        }
+        else if (name == "random") {
+            options.random_plies = int(number);
+        }
+        else if (name == "nodes") {
+            options.limits.nodes = std::uint64_t(number);
+            nodes_given = true;
+        }
+        else if (name == "depth") {
+            options.limits.depth = int(number);
+        }
+        else if (name == "compress") {
+            options.compress = number != 0;
+        }
+        else if (name == "win_score") {
+            options.win_score = int(number);
+        }
+        else if (name == "win_plies") {
+            options.win_plies = int(number);
+        }
+        else if (name == "draw_ply") {
+            options.draw_ply = int(number);
+        }
+        else if (name == "draw_score") {
+            options.draw_score = int(number);
+        }
+        else if (name == "draw_plies") {
+            options.draw_plies = int(number);
+        }
+        else if (name == "max_plies") {
+            options.max_plies = int(number);
+        }
+        else {
+            throw uci::InputError("Unknown datagen option " + name + ".");
+        }
+    }
+
+    // A depth alone means searching to that depth, whatever it takes.
+    if (options.limits.depth > 0 && !nodes_given) {
+        options.limits.nodes = 0;
+    }
+    if (options.limits.depth == 0 && options.limits.nodes == 0) {
+        throw uci::InputError("Datagen needs a depth or node limit.");
+    }
+    return options;
+}
+
+static std::uint64_t mix_seed(std::uint64_t x) {
+    // splitmix64
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Plays random moves from the start position. Openings that end the game
+// are thrown away and drawn again.
+static Board random_opening(std::mt19937_64& rng, int plies) {
+    Movelist moves;
+    while (true) {
+        Board board;
+        bool playable = true;
+        for (int i = 0; i < plies && playable; ++i) {
+            movegen::legalmoves(moves, board);
+            playable = !moves.empty();
+            if (playable) {
+                board.makeMove(moves[std::uniform_int_distribution<int>(0, moves.size() - 1)(rng)]);
+            }
+        }
+        movegen::legalmoves(moves, board);
+        if (playable && !moves.empty()) {
+            return board;
+        }
+    }
+}
+
+// Plays one game, replacing the contents of records with its positions.
+static void play_game(std::uint64_t game, const DatagenOptions& options, FixedSearcher& searcher,
+                      std::vector<TrainingRecord>& records) {
+    std::mt19937_64 rng(mix_seed(options.seed ^ mix_seed(game)));
+    Board board = random_opening(rng, options.random_plies);
+    searcher.clear();
+    records.clear();
+
+    // From white's point of view.
+    int result = 0;
+    int win_streak = 0;
+    int draw_streak = 0;
+    Movelist moves;
+
+    for (int ply = 0; ply < options.max_plies; ++ply) {
+        movegen::legalmoves(moves, board);
+        if (moves.empty()) {
+            result = !board.inCheck() ? 0 : board.sideToMove() == Color::WHITE ? -1 : 1;
+            break;
+        }
+        if (board.isRepetition(2) || board.isHalfMoveDraw() || board.isInsufficientMaterial()) {
+            break;
+        }
+
+        FixedSearchResult searched = searcher.search(board, options.limits);
+        int white_score = board.sideToMove() == Color::WHITE ? searched.score : -searched.score;
+        if (!board.inCheck()) {
+            records.push_back(make_training_record(board, searched.score, 0, searched.best_move));
+        }
+
+        // A win needs both sides to agree on the winner.
+        if (std::abs(white_score) >= options.win_score) {
+            int sign = white_score > 0 ? 1 : -1;
+            win_streak = (win_streak * sign > 0 ? win_streak : 0) + sign;
+            if (std::abs(win_streak) >= options.win_plies) {
+                result = sign;
+                break;
+            }
+        }
+        else {
+            win_streak = 0;
+        }
+
+        draw_streak = ply >= options.draw_ply && std::abs(white_score) <= options.draw_score ? draw_streak + 1 : 0;
+        if (draw_streak >= options.draw_plies) {
+            break;
+        }
+
+        board.makeMove(searched.best_move);
+    }
+
+    // Even plies are white to move.
+    for (TrainingRecord& record: records) {
+        record.result = std::int8_t(record.ply % 2 == 0 ? result : -result);
+    }
+}
+
+DatagenStats run_datagen(const DatagenOptions& options) {
+    TrainingWriter writer(options.output, options.compress);
+
+    std::atomic<std::uint64_t> next_game = 0;
+    std::atomic<std::uint64_t> games_done = 0;
+    std::atomic<std::uint64_t> positions = 0;
+    std::atomic<int> running = options.threads;
+    std::mutex error_mutex;
+    std::string error;
+
+    auto worker = [&](int index) {
+        ThreadPin pin(index);
+        try {
+            FixedSearcher searcher;
+            std::vector<TrainingRecord> buffer;
+            std::vector<TrainingRecord> records;
+            buffer.reserve(DEFAULT_TRAINING_BLOCK_RECORDS + options.max_plies);
+
+            std::uint64_t game;
+            while ((game = next_game.fetch_add(1)) < options.games) {
+                play_game(game, options, searcher, records);
+                buffer.insert(buffer.end(), records.begin(), records.end());
+                positions.fetch_add(records.size(), std::memory_order_relaxed);
+                games_done.fetch_add(1, std::memory_order_relaxed);
+
+                if (buffer.size() >= DEFAULT_TRAINING_BLOCK_RECORDS) {
+                    writer.write_block(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+            }
+            writer.write_block(buffer.data(), buffer.size());
+        }
+        catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            error = e.what();
+            next_game = options.games;
+        }
+        running--;
+    };
+
+    track_memory("datagen tables", options.threads * FixedSearcher::table_bytes_for(DEFAULT_FIXED_SEARCH_TABLE_MB));
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        auto now = std::chrono::steady_clock::now();
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count());
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < options.threads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+
+    std::uint64_t last_report = 0;
+    while (running > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::uint64_t elapsed = elapsed_ms();
+        if (elapsed - last_report >= 10000) {
+            last_report = elapsed;
+            std::uint64_t pps = positions * 1000 / std::max<std::uint64_t>(elapsed, 1);
+            std::cout << "games " << games_done << "/" << options.games
+                      << " positions " << positions
+                      << " pos/s " << pps
+                      << " pos/s/thread " << pps / options.threads << std::endl;
+        }
+    }
+    for (std::thread& t: threads) {
+        t.join();
+    }
+    untrack_memory("datagen tables");
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    writer.finish();
+    return { games_done, positions, elapsed_ms() };
+}
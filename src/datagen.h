@@ -0,0 +1,51 @@
+#ifndef DATAGEN_H
+#define DATAGEN_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fixedsearch.h"
+
+struct DatagenOptions {
+    std::string output = "datagen.bin";
+    std::uint64_t games = 1000;
+    int threads = 1;
+    // Every game is seeded from this and its game number, so the same
+    // options produce the same games whatever the thread count.
+    std::uint64_t seed = 1;
+    // Uniformly random moves played before the first search.
+    int random_plies = 8;
+    SearchLimits limits { 0, 5000 };
+    bool compress = false;
+
+    // Adjudication: a win once the score has been beyond win_score for
+    // win_plies plies in a row, and a draw after draw_ply once it has been
+    // within draw_score for draw_plies plies in a row. Games reaching
+    // max_plies are drawn.
+    int win_score = 1500;
+    int win_plies = 4;
+    int draw_ply = 80;
+    int draw_score = 10;
+    int draw_plies = 8;
+    int max_plies = 400;
+};
+
+struct DatagenStats {
+    std::uint64_t games = 0;
+    std::uint64_t positions = 0;
+    std::uint64_t time_ms = 0;
+};
+
+// Parses 'name value' pairs, such as 'games 1000 nodes 5000', into the
+// options. Throws uci::InputError on unknown names or invalid values.
+DatagenOptions parse_datagen_options(const std::vector<std::string>& words);
+
+// Plays self-play games with fixed searches on options.threads threads,
+// writing every position out of check with its score and the game result.
+// Each thread buffers a block of positions and hands it to the writer once
+// full, so threads only ever wait on each other to append a block to the
+// file. Prints the progress every few seconds.
+DatagenStats run_datagen(const DatagenOptions& options);
+
+#endif //DATAGEN_H
@@ -1,9 +1,33 @@
 #include "engine.h"
 
+#include "bench.h"
+#include "epd.h"
+#include "evalbatch.h"
+#include "latency.h"
+#include "memory.h"
+#include "numa.h"
+#include "perfcounters.h"
 #include "search.h"
 #include "../ext/libuci/uci.h"
 
-void Engine::initialize(int argc, char* argv[]) {
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+// The UCI search keeps no hash table or per-thread state yet, so Hash and
+// Threads allocate nothing, and only the other tracked allocations (book,
+// tablebases) count towards the total.
+static void report_uci_memory() {
+    uci::report_info(uci::info::String("memory search state not allocated (Hash "
+                                       + std::to_string(uci::get_spin_option("Hash")) + " MiB, Threads "
+                                       + std::to_string(uci::get_spin_option("Threads")) + " unused)"));
+    report_memory();
+}
+
+void Engine::initialize() {
 
     // Set up the 'uci' command with your engine name and your own name.
     uci::register_uci("My Engine Name", "My Name");
@@ -16,6 +40,50 @@ void Engine::initialize(int argc, char* argv[]) {
     uci::register_spin_option("Threads", 1, 1, 1);
     uci::register_spin_option("Hash", 32, 1, 1024 * 1024);
 
+    // Pins the worker threads of the multi-threaded modes (datagen, epdtest,
+    // annotate, evalbatch and bench scaling) to one CPU each, spread over
+    // the NUMA nodes, with their search state allocated on their node.
+    uci::register_check_option("PinThreads", false, [](bool enabled) {
+        set_thread_pinning(enabled);
+        if (enabled) {
+            std::size_t cpus = 0;
+            for (const std::vector<int>& node: numa_nodes()) {
+                cpus += node.size();
+            }
+            uci::report_info(uci::info::String("pinning threads to " + std::to_string(cpus) + " cpus on "
+                                               + std::to_string(numa_nodes().size()) + " numa nodes"));
+        }
+    });
+
+    // Back the hash table with reserved huge pages (vm.nr_hugepages) when
+    // there are enough. Transparent huge pages are requested either way.
+    uci::register_check_option("HugeTLB", false);
+
+    // Opt-in CSV log of time management decisions, one line per 'go'.
+    uci::register_string_option("TimeLogFile", "", [&](const std::string& path) {
+        m_time_log.open(path);
+    });
+
+    // Opt-in hardware counters (IPC, cache and branch misses per node)
+    // around each 'go', reported as an info string. Linux only.
+    uci::register_check_option("PerfCounters", false);
+
+    // Polyglot opening book, probed before every search.
+    uci::register_check_option("OwnBook", false);
+    uci::register_string_option("BookFile", "", [&](const std::string& path) {
+        m_book.open(path);
+    });
+    uci::register_check_option("BookBestMove", false);
+
+    // Win/draw/loss tables generated by tools/tbgen, probed at the root.
+    uci::register_string_option("TablebasePath", "", [&](const std::string& path) {
+        std::size_t count = m_tablebases.open(path);
+        if (!path.empty()) {
+            uci::report_info(uci::info::String("tablebases " + std::to_string(count) + " tables, up to "
+                                               + std::to_string(m_tablebases.max_pieces()) + " pieces"));
+        }
+    });
+
     // Set up 'ucinewgame'.
     uci::register_ucinewgame([]() {
         // TODO: Clear anything that shouldn't be kept from game to game here.
@@ -37,27 +105,391 @@ void Engine::initialize(int argc, char* argv[]) {
 
     // Set up 'go'.
     uci::register_go([&](const uci::GoArgs& args) {
+        // Book moves are played instantly, except when analyzing, since
+        // then 'bestmove' is only expected after 'stop'.
+        if (!args.infinite && m_book.loaded() && uci::get_check_option("OwnBook")) {
+            if (auto move = m_book.probe(m_board, uci::get_check_option("BookBestMove"))) {
+                uci::report_best_move(chess::uci::moveToUci(*move));
+                return;
+            }
+        }
+
+        bool count_perf = uci::get_check_option("PerfCounters");
         uci::launch_work_thread([=](const uci::StopSignal& must_stop) {
-            chess::Move best_move = think(m_board, args, must_stop);
-            uci::report_best_move(chess::uci::moveToUci(best_move));
+            // Counters only count the thread that opened them, so
+            // they have to be opened by the search thread itself.
+            std::optional<PerfCounters> counters;
+            if (count_perf) {
+                counters.emplace();
+                counters->start();
+            }
+
+            SearchResult result = think(m_board, args, must_stop, &m_time_log, &m_tablebases);
+
+            if (counters) {
+                PerfSample sample = counters->stop();
+                uci::report_info(uci::info::String(counters->available()
+                                                   ? "perf " + sample.summary(result.nodes)
+                                                   : "perf counters unavailable"));
+            }
+            uci::report_best_move(chess::uci::moveToUci(result.best_move));
         });
     });
 
     // In order to support OpenBench, engines need to be enable "benching"
-    // from command line args.
+    // both as a command and from command line args (see run_command_line).
     uci::register_custom_command("bench", [&](const uci::CommandContext& ctx) {
-       bench();
+        uci::ArgReader reader = ctx.arg_reader();
+        std::string_view mode = reader.read_word();
+        if (mode == "scaling") {
+            auto depth = reader.try_read_int();
+            auto threads = reader.try_read_int();
+            bench_scaling(int(depth.value_or(DEFAULT_SCALING_DEPTH)),
+                          int(threads.value_or(std::thread::hardware_concurrency())));
+            return;
+        }
+        if (mode == "perf") {
+            auto depth = reader.try_read_int();
+            bench_perf(int(depth.value_or(DEFAULT_BENCH_DEPTH)));
+            return;
+        }
+
+        reader.rewind();
+        auto depth = reader.try_read_int();
+        bench(int(depth.value_or(DEFAULT_BENCH_DEPTH)));
+    });
+
+    // Self-play training data generation, e.g. 'datagen games 1000 nodes 5000'
+    // (see DatagenOptions). Blocks the UCI loop until done.
+    uci::register_custom_command("datagen", [&](const uci::CommandContext& ctx) {
+        uci::ArgReader reader = ctx.arg_reader();
+        std::vector<std::string> words;
+        while (!reader.finished()) {
+            std::string_view word = reader.read_word();
+            if (!word.empty()) {
+                words.emplace_back(word);
+            }
+        }
+        try {
+            datagen(parse_datagen_options(words));
+        }
+        catch (const std::runtime_error& e) {
+            throw uci::InputError(e.what());
+        }
+    });
+
+    // Annotates a PGN file: 'annotate <pgn> <output> [name value]...' (see
+    // parse_annotate_options). Blocks the UCI loop until done.
+    uci::register_custom_command("annotate", [&](const uci::CommandContext& ctx) {
+        uci::ArgReader reader = ctx.arg_reader();
+        std::string input(reader.read_word());
+        std::string output(reader.read_word());
+        std::vector<std::string> words;
+        while (!reader.finished()) {
+            std::string_view word = reader.read_word();
+            if (!word.empty()) {
+                words.emplace_back(word);
+            }
+        }
+        try {
+            annotate(input, output, parse_annotate_options(words));
+        }
+        catch (const std::runtime_error& e) {
+            throw uci::InputError(e.what());
+        }
+    });
+
+    // Runs a test suite: 'epdtest <file> <ms> [threads] [nodes]'. A zero time
+    // limit searches to the node limit only.
+    uci::register_custom_command("epdtest", [&](const uci::CommandContext& ctx) {
+        uci::ArgReader reader = ctx.arg_reader();
+        std::string path(reader.read_word());
+        SearchLimits limits {};
+        limits.time_ms = reader.read_int();
+        int threads = int(reader.try_read_int().value_or(std::thread::hardware_concurrency()));
+        limits.nodes = std::uint64_t(reader.try_read_int().value_or(0));
+        epdtest(path, limits, threads);
+    });
+
+    // Reports the memory used by the engine's large allocations.
+    uci::register_custom_command("memory", [](const uci::CommandContext&) {
+        report_uci_memory();
     });
-    if (argc > 1 && argv[1] == std::string("bench")) {
-        bench();
-    }
 
     // Set up other trivial UCI commands.
     uci::register_isready();
     uci::register_quit();
 }
 
-void Engine::bench() {
-    // TODO: Replace with a proper bench implementation.
-    std::cout << "2000 nodes 2000 nps" << std::endl;
-}
\ No newline at end of file
+std::optional<int> Engine::run_command_line(int argc, char* argv[]) {
+    if (argc < 2) {
+        return std::nullopt;
+    }
+
+    std::string mode = argv[1];
+    try {
+        if (mode == "bench" && argc > 2 && argv[2] == std::string("scaling")) {
+            bench_scaling(argc > 3 ? std::stoi(argv[3]) : DEFAULT_SCALING_DEPTH,
+                          argc > 4 ? std::stoi(argv[4]) : int(std::thread::hardware_concurrency()));
+            return 0;
+        }
+        if (mode == "bench" && argc > 2 && argv[2] == std::string("perf")) {
+            bench_perf(argc > 3 ? std::stoi(argv[3]) : DEFAULT_BENCH_DEPTH);
+            return 0;
+        }
+        if (mode == "bench") {
+            bench(argc > 2 ? std::stoi(argv[2]) : DEFAULT_BENCH_DEPTH);
+            return 0;
+        }
+        if (mode == "latency") {
+            latency(argc > 2 ? std::stoi(argv[2]) : DEFAULT_LATENCY_RUNS);
+            return 0;
+        }
+        if (mode == "epdtest" && argc > 3) {
+            SearchLimits limits {};
+            limits.time_ms = std::stoll(argv[3]);
+            limits.nodes = argc > 5 ? std::stoull(argv[5]) : 0;
+            epdtest(argv[2], limits, argc > 4 ? std::stoi(argv[4]) : int(std::thread::hardware_concurrency()));
+            return 0;
+        }
+        if (mode == "annotate" && argc > 3) {
+            annotate(argv[2], argv[3], parse_annotate_options(std::vector<std::string>(argv + 4, argv + argc)));
+            return 0;
+        }
+        if (mode == "evalbatch") {
+            evalbatch(argc > 2 ? argv[2] : "-",
+                      argc > 3 ? std::stoi(argv[3]) : int(std::thread::hardware_concurrency()));
+            return 0;
+        }
+        if (mode == "datagen") {
+            datagen(parse_datagen_options(std::vector<std::string>(argv + 2, argv + argc)));
+            return 0;
+        }
+    }
+    // Thrown by std::stoi and the like on the numeric arguments.
+    catch (const std::invalid_argument&) {
+        std::cerr << "Invalid number in the " << mode << " arguments." << std::endl;
+        return 1;
+    }
+    catch (const std::out_of_range&) {
+        std::cerr << "Number out of range in the " << mode << " arguments." << std::endl;
+        return 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return std::nullopt;
+}
+
+void Engine::bench(int depth) {
+    // The bench is also the training workload for PGO builds, so it runs the
+    // fixed depth search (move generation, evaluation and the table) rather
+    // than perft.
+    BenchResult result = run_bench(depth);
+    std::cout << result.nodes << " nodes " << result.nps() << " nps" << std::endl;
+}
+
+void Engine::bench_scaling(int depth, int max_threads) {
+    PerftTable table(uci::get_spin_option("Hash"), uci::get_check_option("HugeTLB"));
+    std::cout << "hash " << table.size_bytes() / (1024 * 1024) << " MiB, "
+              << page_backing_name(table.backing()) << '\n';
+
+    std::vector<ScalingResult> results = run_scaling_bench(depth, std::max(max_threads, 1), table);
+    const ScalingResult& base = results.front();
+
+    // Speedups are relative to the single threaded run. Duplicate nodes are the
+    // extra nodes searched compared to it, which happen when a thread needs an
+    // entry that another thread hasn't stored yet.
+    auto nps = [](const ScalingResult& r) {
+        return double(r.stats.visited) * 1000 / double(std::max<std::uint64_t>(r.time_ms, 1));
+    };
+
+    std::cout << std::setw(8) << "threads"
+              << std::setw(10) << "time"
+              << std::setw(14) << "nodes"
+              << std::setw(12) << "nps"
+              << std::setw(12) << "nps-speedup"
+              << std::setw(12) << "ttd-speedup"
+              << std::setw(10) << "dup-nodes"
+              << std::setw(10) << "tt-hits" << '\n';
+
+    for (const ScalingResult& r: results) {
+        double dup_ratio = double(r.stats.visited) / double(std::max<std::uint64_t>(base.stats.visited, 1)) - 1;
+        double hit_rate = double(r.stats.tt_hits) / double(std::max<std::uint64_t>(r.stats.tt_probes, 1));
+        double ttd_speedup = double(std::max<std::uint64_t>(base.time_ms, 1))
+                           / double(std::max<std::uint64_t>(r.time_ms, 1));
+
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << r.threads
+                  << std::setw(10) << r.time_ms
+                  << std::setw(14) << r.stats.visited
+                  << std::setw(12) << std::uint64_t(nps(r))
+                  << std::setw(12) << nps(r) / nps(base)
+                  << std::setw(12) << ttd_speedup
+                  << std::setw(9) << dup_ratio * 100 << '%'
+                  << std::setw(9) << hit_rate * 100 << '%' << '\n';
+    }
+    std::cout << std::flush;
+}
+
+void Engine::bench_perf(int depth) {
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::cout << "Hardware performance counters are not available." << std::endl;
+        return;
+    }
+
+    // Counted per position, so that a change can be told apart from
+    // noise in positions it doesn't affect.
+    PerfSample total {};
+    std::uint64_t total_nodes = 0;
+    FixedSearcher searcher;
+    for (std::size_t i = 0; i < BENCH_FENS.size(); ++i) {
+        counters.start();
+        std::uint64_t nodes = bench_position(searcher, BENCH_FENS[i], depth);
+        PerfSample sample = counters.stop();
+
+        std::cout << "position " << std::setw(2) << i + 1 << std::setw(12) << nodes
+                  << " nodes " << sample.summary(nodes) << '\n';
+
+        if (i == 0) {
+            total = sample;
+        }
+        else {
+            total.add(sample);
+        }
+        total_nodes += nodes;
+    }
+    std::cout << "total      " << std::setw(12) << total_nodes
+              << " nodes " << total.summary(total_nodes) << std::endl;
+}
+
+void Engine::latency(int runs) {
+    std::vector<LatencyResult> results = run_latency_bench(std::max(runs, 1));
+
+    std::cout << std::left << std::setw(44) << "exchange (us)" << std::right
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p90"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "max" << '\n';
+
+    for (const LatencyResult& r: results) {
+        std::cout << std::left << std::setw(44) << r.name << std::right
+                  << std::setw(10) << r.percentile(50)
+                  << std::setw(10) << r.percentile(90)
+                  << std::setw(10) << r.percentile(99)
+                  << std::setw(10) << r.percentile(100) << '\n';
+    }
+    std::cout << std::flush;
+}
+
+void Engine::datagen(const DatagenOptions& options) {
+    DatagenStats stats = run_datagen(options);
+    double seconds = double(std::max<std::uint64_t>(stats.time_ms, 1)) / 1000;
+    double pps = double(stats.positions) / seconds;
+    std::cout << stats.games << " games " << stats.positions << " positions in " << seconds << " s, "
+              << std::uint64_t(pps) << " pos/s, " << std::uint64_t(pps / options.threads) << " pos/s/thread" << std::endl;
+}
+
+template <typename T>
+static T percentile(std::vector<T> values, int p) {
+    if (values.empty()) {
+        return T {};
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * p / 100)];
+}
+
+void Engine::epdtest(const std::string& path, const SearchLimits& limits, int threads) {
+    if (limits.time_ms <= 0 && limits.nodes == 0) {
+        throw uci::InputError("epdtest needs a time or node limit.");
+    }
+    std::vector<EpdPosition> suite = load_epd_suite(path);
+    std::vector<EpdResult> results = run_epd_suite(suite, limits, std::max(threads, 1));
+
+    std::vector<std::int64_t> solve_times;
+    std::vector<std::uint64_t> solve_nodes;
+    std::uint64_t total_nodes = 0;
+    std::int64_t total_time = 0;
+
+    for (std::size_t i = 0; i < suite.size(); ++i) {
+        const EpdResult& r = results[i];
+        total_nodes += r.nodes;
+        total_time += r.time_ms;
+        if (r.solved) {
+            solve_times.push_back(r.solve_time_ms);
+            solve_nodes.push_back(r.solve_nodes);
+            continue;
+        }
+
+        // Only failures are listed, with the expected moves.
+        std::cout << "failed " << std::left << std::setw(16) << suite[i].id << std::right
+                  << " played " << chess::uci::moveToSan(suite[i].board, r.best_move);
+        for (const chess::Move& move: suite[i].best_moves) {
+            std::cout << " bm " << chess::uci::moveToSan(suite[i].board, move);
+        }
+        for (const chess::Move& move: suite[i].avoid_moves) {
+            std::cout << " am " << chess::uci::moveToSan(suite[i].board, move);
+        }
+        std::cout << '\n';
+    }
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "solved " << solve_times.size() << "/" << suite.size()
+              << " (" << 100.0 * double(solve_times.size()) / double(std::max<std::size_t>(suite.size(), 1)) << "%)\n"
+              << "time to solution (ms): p50 " << percentile(solve_times, 50)
+              << " p90 " << percentile(solve_times, 90) << " max " << percentile(solve_times, 100) << '\n'
+              << "nodes to solution:     p50 " << percentile(solve_nodes, 50)
+              << " p90 " << percentile(solve_nodes, 90) << " max " << percentile(solve_nodes, 100) << '\n'
+              << "searched " << total_nodes << " nodes in " << total_time << " ms of search, "
+              << total_nodes * 1000 / std::uint64_t(std::max<std::int64_t>(total_time, 1)) << " nps per thread" << std::endl;
+}
+
+void Engine::evalbatch(const std::string& path, int threads) {
+    // Only used as a command line mode, before anything else was printed.
+    std::ios::sync_with_stdio(false);
+
+    EvalBatchStats stats;
+    if (path == "-") {
+        stats = run_evalbatch(std::cin, std::cout, threads);
+    }
+    else {
+        std::ifstream file(path);
+        if (!file) {
+            throw uci::InputError("Could not open " + path + ".");
+        }
+        stats = run_evalbatch(file, std::cout, threads);
+    }
+
+    // On stderr, so that stdout only holds the scores.
+    double seconds = double(std::max<std::uint64_t>(stats.time_ms, 1)) / 1000;
+    std::cerr << stats.positions << " positions in " << seconds << " s, "
+              << std::uint64_t(double(stats.positions) / seconds) << " pos/s" << std::endl;
+}
+
+void Engine::annotate(const std::string& input, const std::string& output, const AnnotateOptions& options) {
+    AnnotateStats stats = annotate_pgn(input, output, options);
+    double seconds = double(std::max<std::uint64_t>(stats.time_ms, 1)) / 1000;
+    std::cout << stats.games << " games " << stats.positions << " positions in " << seconds << " s, "
+              << std::uint64_t(double(stats.positions) / seconds) << " pos/s";
+    if (stats.truncated_games > 0) {
+        std::cout << ", " << stats.truncated_games << " games with an invalid move annotated up to it";
+    }
+    if (stats.skipped_games > 0) {
+        std::cout << ", " << stats.skipped_games << " games with an invalid FEN skipped";
+    }
+    std::cout << std::endl;
+}
+
+int engine_main(int argc, char* argv[]) {
+    Engine e {};
+    e.initialize();
+    if (std::optional<int> status = e.run_command_line(argc, argv)) {
+        return *status;
+    }
+    report_uci_memory();
+    uci::main_loop();
+    return 0;
+}
@@ -2,18 +2,46 @@
 #define ENGINE_H
 
 #include <atomic>
+#include <optional>
 
 #include "../ext/chess/chess.h"
+#include "annotate.h"
+#include "book.h"
+#include "datagen.h"
+#include "fixedsearch.h"
+#include "tablebase.h"
+#include "timelog.h"
 
 class Engine {
 public:
-    void initialize(int argc, char* argv[]);
-    static void bench();
+    void initialize();
+
+    // Handles command line modes, such as 'bench'. Returns the
+    // process exit status if a mode was run (non-zero if it failed),
+    // in which case the UCI loop should not be entered.
+    std::optional<int> run_command_line(int argc, char* argv[]);
+
+    static void bench(int depth);
+    static void bench_scaling(int depth, int max_threads);
+    static void bench_perf(int depth);
+    static void latency(int runs);
+    static void datagen(const DatagenOptions& options);
+    static void epdtest(const std::string& path, const SearchLimits& limits, int threads);
+    static void evalbatch(const std::string& path, int threads);
+    static void annotate(const std::string& input, const std::string& output, const AnnotateOptions& options);
 
 private:
     chess::Board m_board {};
     std::atomic_bool m_should_stop_search {};
+    TimeLog m_time_log {};
+    Book m_book {};
+    Tablebases m_tablebases {};
 };
 
+// Runs the engine: handles command line modes or enters the UCI loop.
+// In multi-ISA builds, each build variant has its own copy of this
+// function, renamed to engine_main_<level> (hence the C linkage, which
+// keeps the symbol name predictable).
+extern "C" int engine_main(int argc, char* argv[]);
 
 #endif //ENGINE_H
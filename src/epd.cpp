@@ -0,0 +1,167 @@
+#include "epd.h"
+
+#include "fen.h"
+#include "memory.h"
+#include "numa.h"
+#include "san.h"
+#include "../ext/libuci/uci.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <optional>
+#include <thread>
+
+using namespace chess;
+
+bool EpdPosition::solved_by(Move move) const {
+    auto contains = [&](const std::vector<Move>& moves) {
+        return std::find(moves.begin(), moves.end(), move) != moves.end();
+    };
+    return (best_moves.empty() || contains(best_moves)) && !contains(avoid_moves);
+}
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+// Splits the operations after the four position fields, such as
+// 'bm Qd1 Qe2; id "WAC.001";', into (opcode, operands) pairs.
+static std::vector<std::pair<std::string_view, std::string_view>> epd_operations(std::string_view line) {
+    for (int field = 0; field < 4; ++field) {
+        line = trim(line);
+        line.remove_prefix(std::min(line.find(' '), line.size()));
+    }
+
+    std::vector<std::pair<std::string_view, std::string_view>> operations;
+    while (!(line = trim(line)).empty()) {
+        // Quoted operands may contain semicolons.
+        std::size_t end = 0;
+        bool quoted = false;
+        while (end < line.size() && (quoted || line[end] != ';')) {
+            quoted ^= line[end] == '"';
+            end++;
+        }
+        std::string_view operation = trim(line.substr(0, end));
+        line.remove_prefix(std::min(end + 1, line.size()));
+
+        std::size_t space = std::min(operation.find(' '), operation.size());
+        operations.emplace_back(operation.substr(0, space), trim(operation.substr(space)));
+    }
+    return operations;
+}
+
+std::vector<EpdPosition> load_epd_suite(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw uci::InputError("Could not open " + path + ".");
+    }
+
+    std::vector<EpdPosition> suite;
+    Movelist scratch;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (trim(line).empty()) {
+            continue;
+        }
+        auto error = [&](const std::string& message) {
+            return uci::InputError(path + ":" + std::to_string(line_number) + ": " + message);
+        };
+
+        EpdPosition position;
+        if (FenError fen_error = try_parse_fen(position.board, trim(line)); fen_error != FenError::None) {
+            throw error(std::string("invalid position: ") + fen_error_name(fen_error) + ".");
+        }
+        position.id = "#" + std::to_string(line_number);
+
+        for (auto [opcode, operands]: epd_operations(line)) {
+            if (opcode == "id") {
+                position.id = std::string(operands.size() >= 2 && operands.front() == '"'
+                                          ? operands.substr(1, operands.size() - 2)
+                                          : operands);
+                continue;
+            }
+            if (opcode != "bm" && opcode != "am") {
+                continue;
+            }
+
+            std::vector<Move>& moves = opcode == "bm" ? position.best_moves : position.avoid_moves;
+            while (!(operands = trim(operands)).empty()) {
+                std::size_t space = std::min(operands.find(' '), operands.size());
+                std::string_view san = operands.substr(0, space);
+                operands.remove_prefix(space);
+
+                Move move;
+                if (SanError san_error = try_parse_san(position.board, san, move, scratch); san_error != SanError::None) {
+                    throw error(std::string(opcode) + " move " + std::string(san) + ": " + san_error_name(san_error) + ".");
+                }
+                moves.push_back(move);
+            }
+        }
+
+        if (!position.best_moves.empty() || !position.avoid_moves.empty()) {
+            suite.push_back(std::move(position));
+        }
+    }
+    return suite;
+}
+
+std::vector<EpdResult> run_epd_suite(const std::vector<EpdPosition>& suite,
+                                     const SearchLimits& limits, int threads) {
+    std::vector<EpdResult> results(suite.size());
+    std::atomic<std::size_t> next = 0;
+
+    auto worker = [&](int index) {
+        ThreadPin pin(index);
+        FixedSearcher searcher;
+        std::size_t i;
+        while ((i = next.fetch_add(1)) < suite.size()) {
+            const EpdPosition& position = suite[i];
+            EpdResult& result = results[i];
+            Board board = position.board;
+            searcher.clear();
+
+            // The solution has to hold until the end of the search, so the
+            // first solving iteration is forgotten whenever one fails.
+            std::optional<FixedSearchResult> first_solved;
+            FixedSearchResult searched = searcher.search(board, limits, nullptr, [&](const FixedSearchResult& iteration) {
+                if (!position.solved_by(iteration.best_move)) {
+                    first_solved.reset();
+                }
+                else if (!first_solved) {
+                    first_solved = iteration;
+                }
+            });
+
+            result.best_move = searched.best_move;
+            result.nodes = searched.nodes;
+            result.time_ms = searched.time_ms;
+            result.solved = position.solved_by(searched.best_move) && first_solved;
+            if (result.solved) {
+                result.solve_time_ms = first_solved->time_ms;
+                result.solve_nodes = first_solved->nodes;
+            }
+        }
+    };
+
+    track_memory("epdtest tables", threads * FixedSearcher::table_bytes_for(DEFAULT_FIXED_SEARCH_TABLE_MB));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for (std::thread& t: workers) {
+        t.join();
+    }
+    untrack_memory("epdtest tables");
+    return results;
+}
@@ -0,0 +1,43 @@
+#ifndef EPD_H
+#define EPD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "fixedsearch.h"
+
+// A test position with its 'bm' (best moves) and 'am' (avoid moves)
+// operations. A search solves it by finding any of the best moves, if
+// there are some, and none of the moves to avoid.
+struct EpdPosition {
+    std::string id;
+    chess::Board board;
+    std::vector<chess::Move> best_moves;
+    std::vector<chess::Move> avoid_moves;
+
+    [[nodiscard]] bool solved_by(chess::Move move) const;
+};
+
+// Loads a test suite, one EPD per line. Lines without 'bm' or 'am' are
+// skipped. Throws uci::InputError on unreadable files or invalid positions.
+std::vector<EpdPosition> load_epd_suite(const std::string& path);
+
+struct EpdResult {
+    chess::Move best_move = chess::Move::NO_MOVE;
+    std::uint64_t nodes = 0;
+    std::int64_t time_ms = 0;
+    // Whether the final best move solves the position, and if so, the time
+    // and nodes of the first iteration from which it was solved for good.
+    bool solved = false;
+    std::int64_t solve_time_ms = 0;
+    std::uint64_t solve_nodes = 0;
+};
+
+// Searches every position with the given limits, spreading the positions
+// over threads (one search per thread). Results are in suite order.
+std::vector<EpdResult> run_epd_suite(const std::vector<EpdPosition>& suite,
+                                     const SearchLimits& limits, int threads);
+
+#endif //EPD_H
@@ -0,0 +1,155 @@
+#include "eval.h"
+
+#include "kpk.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace chess;
+
+static constexpr int PHASE_WEIGHTS[6] = { 0, 1, 1, 2, 4, 0 };
+
+static PieceType piece_type(int index) {
+    return PieceType(static_cast<PieceType::underlying>(index));
+}
+
+// Starting values: common material values and simple piece-square shapes
+// (advanced pawns, centralized minor pieces, rooks on the seventh, a
+// sheltered king in the middlegame and an active one in the endgame).
+// Run the tuner to fit them to actual games.
+static EvalParams make_default_params() {
+    EvalParams params {};
+    constexpr int MATERIAL_MG[6] = { 82, 337, 365, 477, 1025, 0 };
+    constexpr int MATERIAL_EG[6] = { 94, 281, 297, 512, 936, 0 };
+
+    for (int pt = 0; pt < 6; ++pt) {
+        params.mg[PARAM_MATERIAL + pt] = MATERIAL_MG[pt];
+        params.eg[PARAM_MATERIAL + pt] = MATERIAL_EG[pt];
+
+        for (int sq = 0; sq < 64; ++sq) {
+            int file = sq % 8;
+            int rank = sq / 8;
+            int centrality = std::min(file, 7 - file) + std::min(rank, 7 - rank);
+            int mg = 0;
+            int eg = 0;
+
+            switch (pt) {
+                case 0:
+                    if (rank > 0 && rank < 7) {
+                        bool center = (file == 3 || file == 4) && (rank == 3 || rank == 4);
+                        mg = (rank - 1) * 5 + (center ? 15 : 0);
+                        eg = (rank - 1) * 12;
+                    }
+                    break;
+                case 1:
+                    mg = centrality * 8 - 25;
+                    eg = centrality * 6 - 20;
+                    break;
+                case 2:
+                    mg = eg = centrality * 4 - 10;
+                    break;
+                case 3:
+                    mg = (rank == 6 ? 20 : 0) + std::min(file, 7 - file) * 2;
+                    eg = rank == 6 ? 10 : 0;
+                    break;
+                case 4:
+                    mg = centrality * 2 - 5;
+                    eg = centrality * 5 - 15;
+                    break;
+                case 5:
+                    mg = rank == 0 ? (file <= 2 || file >= 6 ? 20 : 0) : -10 * std::min(rank, 4);
+                    eg = centrality * 10 - 30;
+                    break;
+            }
+            params.mg[PARAM_PSQT + pt * 64 + sq] = mg;
+            params.eg[PARAM_PSQT + pt * 64 + sq] = eg;
+        }
+    }
+
+    params.mg[PARAM_BISHOP_PAIR] = 30;
+    params.eg[PARAM_BISHOP_PAIR] = 50;
+    return params;
+}
+
+const EvalParams DEFAULT_EVAL_PARAMS = make_default_params();
+
+int eval_phase(const Board& board) {
+    int phase = 0;
+    for (int pt = 1; pt < 5; ++pt) {
+        phase += PHASE_WEIGHTS[pt] * board.pieces(piece_type(pt)).count();
+    }
+    return std::min(phase, EVAL_PHASE_MAX);
+}
+
+int evaluate(const Board& board, const EvalParams& params) {
+    int mg = 0;
+    int eg = 0;
+
+    for (int color = 0; color < 2; ++color) {
+        int sign = color == 0 ? 1 : -1;
+        // Black's squares are mirrored vertically.
+        int flip = color == 0 ? 0 : 56;
+
+        for (int pt = 0; pt < 6; ++pt) {
+            Bitboard pieces = board.pieces(piece_type(pt), Color(color));
+            while (pieces) {
+                int index = PARAM_PSQT + pt * 64 + (pieces.pop() ^ flip);
+                mg += sign * (params.mg[PARAM_MATERIAL + pt] + params.mg[index]);
+                eg += sign * (params.eg[PARAM_MATERIAL + pt] + params.eg[index]);
+            }
+        }
+
+        if (board.pieces(PieceType::BISHOP, Color(color)).count() >= 2) {
+            mg += sign * params.mg[PARAM_BISHOP_PAIR];
+            eg += sign * params.eg[PARAM_BISHOP_PAIR];
+        }
+    }
+
+    int phase = eval_phase(board);
+    int score = (mg * phase + eg * (EVAL_PHASE_MAX - phase)) / EVAL_PHASE_MAX;
+    if (is_kpk(board)) {
+        if (!kpk_is_win(board)) {
+            return 0;
+        }
+        score += board.pieces(PieceType::PAWN, Color::WHITE) ? KNOWN_WIN_SCORE : -KNOWN_WIN_SCORE;
+    }
+    return board.sideToMove() == Color::WHITE ? score : -score;
+}
+
+void eval_features(const Board& board, std::vector<EvalFeature>& features) {
+    features.clear();
+    auto add = [&](int index, int coefficient) {
+        auto it = std::find_if(features.begin(), features.end(), [&](const EvalFeature& f) {
+            return f.index == index;
+        });
+        if (it == features.end()) {
+            features.push_back({ std::uint16_t(index), std::int16_t(coefficient) });
+        }
+        else {
+            it->coefficient = std::int16_t(it->coefficient + coefficient);
+        }
+    };
+
+    for (int color = 0; color < 2; ++color) {
+        int sign = color == 0 ? 1 : -1;
+        int flip = color == 0 ? 0 : 56;
+
+        for (int pt = 0; pt < 6; ++pt) {
+            Bitboard pieces = board.pieces(piece_type(pt), Color(color));
+            if (int count = pieces.count()) {
+                add(PARAM_MATERIAL + pt, sign * count);
+            }
+            while (pieces) {
+                add(PARAM_PSQT + pt * 64 + (pieces.pop() ^ flip), sign);
+            }
+        }
+
+        if (board.pieces(PieceType::BISHOP, Color(color)).count() >= 2) {
+            add(PARAM_BISHOP_PAIR, sign);
+        }
+    }
+
+    features.erase(std::remove_if(features.begin(), features.end(), [](const EvalFeature& f) {
+        return f.coefficient == 0;
+    }), features.end());
+}
@@ -0,0 +1,53 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+
+// Tapered evaluation: every parameter has a middlegame and an endgame value,
+// blended by the game phase. The evaluation is linear in the parameters, so
+// that they can be tuned from positions with known outcomes.
+constexpr int EVAL_PHASE_MAX = 24;
+
+// Added to the score of positions known to be won (such as KPK wins from the
+// bitbase), so that they rank above any material advantage but below mates.
+constexpr int KNOWN_WIN_SCORE = 10000;
+
+// Parameter indices. Piece-square entries are indexed by piece type and
+// square from white's point of view (a1 = 0); black's are mirrored.
+constexpr int PARAM_MATERIAL = 0;
+constexpr int PARAM_PSQT = PARAM_MATERIAL + 6;
+constexpr int PARAM_BISHOP_PAIR = PARAM_PSQT + 6 * 64;
+constexpr int EVAL_PARAM_COUNT = PARAM_BISHOP_PAIR + 1;
+
+struct EvalParams {
+    std::array<int, EVAL_PARAM_COUNT> mg {};
+    std::array<int, EVAL_PARAM_COUNT> eg {};
+};
+
+extern const EvalParams DEFAULT_EVAL_PARAMS;
+
+// A parameter's coefficient in a position: its number of occurrences for
+// white minus those for black.
+struct EvalFeature {
+    std::uint16_t index;
+    std::int16_t coefficient;
+};
+
+// Game phase, from 0 (pawn endgame) to EVAL_PHASE_MAX (all pieces on board).
+int eval_phase(const chess::Board& board);
+
+// Score of the position in centipawns, from the side to move's point of view.
+// KPK positions are exact: 0 for draws, and KNOWN_WIN_SCORE on top of the
+// usual score for wins, which keeps the pawn advancing.
+int evaluate(const chess::Board& board, const EvalParams& params = DEFAULT_EVAL_PARAMS);
+
+// Non-zero features of the position, replacing the contents of features. The
+// white point of view score is then the sum of coefficient * (mg * phase +
+// eg * (EVAL_PHASE_MAX - phase)) / EVAL_PHASE_MAX over all features.
+void eval_features(const chess::Board& board, std::vector<EvalFeature>& features);
+
+#endif //EVAL_H
@@ -0,0 +1,88 @@
+#include "evalbatch.h"
+
+#include "eval.h"
+#include "fen.h"
+#include "fixedsearch.h"
+#include "pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace chess;
+
+static constexpr std::size_t BATCH_LINES = 1024;
+
+// Evaluates a batch of lines, returning its output lines.
+static std::string evaluate_lines(const std::vector<std::string>& lines, FixedSearcher& searcher,
+                                  std::uint64_t& positions) {
+    std::string output;
+    output.reserve(lines.size() * 12);
+    Board board;
+
+    for (const std::string& line: lines) {
+        std::string_view fen = line;
+        fen = fen.substr(0, std::min(fen.find('|'), fen.size()));
+        while (!fen.empty() && std::isspace(static_cast<unsigned char>(fen.back()))) {
+            fen.remove_suffix(1);
+        }
+        if (fen.empty()) {
+            output += '\n';
+            continue;
+        }
+
+        if (try_parse_fen(board, fen) != FenError::None) {
+            output += "invalid\n";
+            continue;
+        }
+        int sign = board.sideToMove() == Color::WHITE ? 1 : -1;
+        output += std::to_string(sign * evaluate(board));
+        output += ' ';
+        output += std::to_string(sign * searcher.quiesce(board));
+        output += '\n';
+        positions++;
+    }
+    return output;
+}
+
+EvalBatchStats run_evalbatch(std::istream& in, std::ostream& out, int threads) {
+    threads = std::max(threads, 1);
+    std::atomic<std::uint64_t> positions = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        OrderedPipeline<std::vector<std::string>, std::string> pipeline(
+            threads, 4 * std::size_t(threads),
+            [&]() {
+                // The quiescence search doesn't use the transposition table.
+                return [&, searcher = FixedSearcher(0)](std::vector<std::string>& lines) mutable {
+                    std::uint64_t count = 0;
+                    std::string output = evaluate_lines(lines, searcher, count);
+                    positions.fetch_add(count, std::memory_order_relaxed);
+                    return output;
+                };
+            },
+            [&](const std::string& output) { out << output; });
+
+        bool more = true;
+        while (more) {
+            std::vector<std::string> lines;
+            lines.reserve(BATCH_LINES);
+            std::string line;
+            while (lines.size() < BATCH_LINES && (more = bool(std::getline(in, line)))) {
+                lines.push_back(std::move(line));
+            }
+            if (!lines.empty()) {
+                pipeline.submit(std::move(lines));
+            }
+        }
+    }
+    out.flush();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return { positions, std::uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) };
+}
@@ -0,0 +1,23 @@
+#ifndef EVALBATCH_H
+#define EVALBATCH_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+struct EvalBatchStats {
+    std::uint64_t positions = 0;
+    std::uint64_t time_ms = 0;
+};
+
+// Reads one FEN per line and writes '<eval> <qsearch>' for each, both from
+// white's point of view, in input order. Anything after a '|' is ignored, so
+// text datasets ('<fen> | <score> | <wdl>') can be read as they are. Empty
+// lines are echoed as empty lines, and invalid FENs give 'invalid'.
+//
+// The caller's thread reads batches of lines, which go through an
+// OrderedPipeline: worker threads evaluate them and a writer thread outputs
+// them in order.
+EvalBatchStats run_evalbatch(std::istream& in, std::ostream& out, int threads);
+
+#endif //EVALBATCH_H
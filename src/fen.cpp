@@ -0,0 +1,275 @@
+#include "fen.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace chess;
+
+const char* fen_error_name(FenError error) {
+    switch (error) {
+        case FenError::None:         return "none";
+        case FenError::Placement:    return "piece placement";
+        case FenError::Kings:        return "kings";
+        case FenError::SideToMove:   return "side to move";
+        case FenError::Castling:     return "castling";
+        case FenError::EnPassant:    return "en passant";
+        case FenError::MoveCounters: return "move counters";
+    }
+    return "unknown";
+}
+
+namespace {
+
+// Board keeps its state in protected members, which member pointers taken
+// through a derived class can reach on any Board.
+struct BoardState : Board {
+    static constexpr auto pieces_bb = &BoardState::pieces_bb_;
+    static constexpr auto occ_bb = &BoardState::occ_bb_;
+    static constexpr auto board = &BoardState::board_;
+    static constexpr auto key = &BoardState::key_;
+    static constexpr auto cr = &BoardState::cr_;
+    static constexpr auto plies = &BoardState::plies_;
+    static constexpr auto stm = &BoardState::stm_;
+    static constexpr auto ep_sq = &BoardState::ep_sq_;
+    static constexpr auto hfm = &BoardState::hfm_;
+    static constexpr auto prev_states = &BoardState::prev_states_;
+};
+
+}
+
+// What each character of the piece placement field does: the piece it
+// places (NO_PIECE for none), how far it moves along the squares, and
+// whether it is invalid. Looking everything up lets the placement loop run
+// without branches, which matters since FENs are all different and the
+// branches of a character-by-character parser mispredict constantly.
+static constexpr std::uint8_t NO_PIECE = 12;
+
+struct PlacementChar {
+    std::uint8_t piece = NO_PIECE;
+    std::int8_t delta = 0;
+    bool invalid = true;
+};
+
+static constexpr std::array<PlacementChar, 256> PLACEMENT_CHARS = [] {
+    std::array<PlacementChar, 256> chars {};
+    const char* letters = "PNBRQKpnbrqk";
+    for (int i = 0; i < 12; ++i) {
+        chars[std::size_t(letters[i])] = { std::uint8_t(i), 1, false };
+    }
+    for (int n = 1; n <= 8; ++n) {
+        chars[std::size_t('0' + n)] = { NO_PIECE, std::int8_t(n), false };
+    }
+    // From the end of a rank to the start of the one below.
+    chars[std::size_t('/')] = { NO_PIECE, -16, false };
+    return chars;
+}();
+
+// Reads the next space-separated field, skipping leading spaces.
+static std::string_view next_field(std::string_view& fen) {
+    std::size_t start = 0;
+    while (start < fen.size() && fen[start] == ' ') {
+        start++;
+    }
+    std::size_t end = std::min(fen.find(' ', start), fen.size());
+    std::string_view field = fen.substr(start, end - start);
+    fen.remove_prefix(end);
+    return field;
+}
+
+// Parses a whole field as a number no larger than max.
+static bool parse_number(std::string_view field, std::uint32_t max, std::uint32_t& value) {
+    if (field.empty() || field.size() > 9) {
+        return false;
+    }
+    value = 0;
+    for (char c: field) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + std::uint32_t(c - '0');
+    }
+    return value <= max;
+}
+
+// The file of the first rook of the color found walking from the king
+// towards the corner, as setFen does for Chess960 'KQkq' letters.
+static File find_castling_rook(const Board& board, Color color, Board::CastlingRights::Side side) {
+    bool king_side = side == Board::CastlingRights::Side::KING_SIDE;
+    Square king = board.kingSq(color);
+    int rank = king.rank();
+    for (int file = int(king.file()) + (king_side ? 1 : -1); file >= 0 && file < 8; file += king_side ? 1 : -1) {
+        Piece piece = board.at(Square(file + rank * 8));
+        if (piece.type() == PieceType::ROOK && piece.color() == color) {
+            return File(file);
+        }
+    }
+    return File::NO_FILE;
+}
+
+FenError try_parse_fen(Board& board, std::string_view fen) noexcept {
+    using Side = Board::CastlingRights::Side;
+
+    std::string_view placement = next_field(fen);
+    std::string_view side_to_move = next_field(fen);
+    std::string_view castling = next_field(fen);
+    std::string_view en_passant = next_field(fen);
+
+    // Piece placement, from a8 to h1. Bitboards and squares are indexed by
+    // piece, with an extra slot collecting what non-pieces write.
+    std::array<std::uint64_t, NO_PIECE + 1> bitboards {};
+    std::array<std::uint8_t, 65> mailbox;
+    mailbox.fill(NO_PIECE);
+
+    int square = 56;
+    int ranks_done = 0;
+    bool bad = false;
+    for (char c: placement) {
+        const PlacementChar& pc = PLACEMENT_CHARS[static_cast<unsigned char>(c)];
+        bool rank_end = c == '/';
+        int end_square = 64 - 8 * ranks_done;
+
+        bitboards[pc.piece] |= 1ull << (square & 63);
+        mailbox[pc.piece < NO_PIECE ? square & 63 : 64] = pc.piece;
+
+        // A '/' must come exactly at the end of a rank (and there are only
+        // eight), and nothing else may go past it.
+        bad |= pc.invalid | (rank_end & (square != end_square)) | (ranks_done >= 7 && rank_end);
+        square += pc.delta;
+        bad |= !rank_end & (square > end_square);
+        ranks_done += rank_end;
+    }
+    if (bad || ranks_done != 7 || square != 8) {
+        return FenError::Placement;
+    }
+
+    std::array<std::uint64_t, 6> pieces {};
+    std::array<std::uint64_t, 2> occupancy {};
+    for (int i = 0; i < 6; ++i) {
+        pieces[i] = bitboards[i] | bitboards[i + 6];
+        occupancy[0] |= bitboards[i];
+        occupancy[1] |= bitboards[i + 6];
+    }
+
+    std::uint64_t kings = pieces[int(PieceType::KING)];
+    if (__builtin_popcountll(kings & occupancy[0]) != 1 || __builtin_popcountll(kings & occupancy[1]) != 1) {
+        return FenError::Kings;
+    }
+    for (int i = 0; i < 6; ++i) {
+        (board.*BoardState::pieces_bb)[i] = Bitboard(pieces[i]);
+    }
+    for (int i = 0; i < 2; ++i) {
+        (board.*BoardState::occ_bb)[i] = Bitboard(occupancy[i]);
+    }
+    static_assert(sizeof(Piece) == 1, "Piece is copied from bytes.");
+    std::memcpy((board.*BoardState::board).data(), mailbox.data(), 64);
+
+    Color& stm = board.*BoardState::stm;
+    if (side_to_move.empty() || side_to_move == "w") {
+        stm = Color::WHITE;
+    }
+    else if (side_to_move == "b") {
+        stm = Color::BLACK;
+    }
+    else {
+        return FenError::SideToMove;
+    }
+
+    // Standard castling rights are set whether or not the pieces are in
+    // place, like setFen does.
+    Board::CastlingRights& rights = board.*BoardState::cr;
+    rights.clear();
+    if (castling != "-") {
+        for (char c: castling) {
+            Color color = c >= 'a' ? Color::BLACK : Color::WHITE;
+            char letter = char(c >= 'a' ? c - 'a' + 'A' : c);
+            Side side = letter == 'K' ? Side::KING_SIDE : Side::QUEEN_SIDE;
+
+            if (letter != 'K' && letter != 'Q' && (!board.chess960() || letter < 'A' || letter > 'H')) {
+                return FenError::Castling;
+            }
+            if (!board.chess960()) {
+                rights.setCastlingRight(color, side, side == Side::KING_SIDE ? File::FILE_H : File::FILE_A);
+                continue;
+            }
+
+            File rook = File::NO_FILE;
+            if (letter == 'K' || letter == 'Q') {
+                rook = find_castling_rook(board, color, side);
+            }
+            else {
+                rook = File(letter - 'A');
+                side = Board::CastlingRights::closestSide(rook, board.kingSq(color).file());
+            }
+            if (rook == File::NO_FILE) {
+                return FenError::Castling;
+            }
+            rights.setCastlingRight(color, side, rook);
+        }
+    }
+
+    Square& ep = board.*BoardState::ep_sq;
+    ep = Square::NO_SQ;
+    if (!en_passant.empty() && en_passant != "-") {
+        if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h'
+            || en_passant[1] < '1' || en_passant[1] > '8') {
+            return FenError::EnPassant;
+        }
+        ep = Square(en_passant[0] - 'a' + (en_passant[1] - '1') * 8);
+    }
+
+    // Counters, if present; EPD operations may follow the first four fields.
+    std::uint32_t half_moves = 0;
+    std::uint32_t full_moves = 1;
+    std::string_view rest = fen;
+    std::string_view field = next_field(rest);
+    if (!field.empty() && field[0] >= '0' && field[0] <= '9') {
+        if (!parse_number(field, 255, half_moves)) {
+            return FenError::MoveCounters;
+        }
+        field = next_field(rest);
+        if (!field.empty() && field.back() == ';') {
+            field.remove_suffix(1);
+        }
+        if (!field.empty() && !parse_number(field, 30000, full_moves)) {
+            return FenError::MoveCounters;
+        }
+    }
+    board.*BoardState::hfm = std::uint8_t(half_moves);
+    board.*BoardState::plies = std::uint16_t(std::max<std::uint32_t>(full_moves, 1) * 2 - 2 + (stm == Color::BLACK));
+    (board.*BoardState::prev_states).clear();
+
+    // Like setFen, keep an en passant square only if the side to move has a
+    // legal capture on it. Many datasets write the square after every double
+    // push, so the captures are only generated when a pawn is next to it.
+    if (ep != Square::NO_SQ) {
+        bool valid = ep.rank() == (stm == Color::WHITE ? Rank::RANK_6 : Rank::RANK_3);
+        if (valid) {
+            int pawn_rank = stm == Color::WHITE ? 4 : 3;
+            int ep_file = ep.index() % 8;
+            std::uint64_t neighbours = 0;
+            if (ep_file > 0) {
+                neighbours |= 1ull << (pawn_rank * 8 + ep_file - 1);
+            }
+            if (ep_file < 7) {
+                neighbours |= 1ull << (pawn_rank * 8 + ep_file + 1);
+            }
+            valid = (neighbours & pieces[int(PieceType::PAWN)] & occupancy[stm == Color::WHITE ? 0 : 1]) != 0;
+        }
+        if (valid) {
+            Movelist captures;
+            movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board);
+            valid = false;
+            for (const Move& move: captures) {
+                valid |= move.typeOf() == Move::ENPASSANT;
+            }
+        }
+        if (!valid) {
+            ep = Square::NO_SQ;
+        }
+    }
+
+    board.*BoardState::key = board.zobrist();
+    return FenError::None;
+}
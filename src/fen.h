@@ -0,0 +1,32 @@
+#ifndef FEN_H
+#define FEN_H
+
+#include <string_view>
+
+#include "../ext/chess/chess.h"
+
+enum class FenError {
+    None,
+    Placement,    // Unknown piece, or ranks not adding up to the board.
+    Kings,        // Not exactly one king per side.
+    SideToMove,   // Neither 'w' nor 'b'.
+    Castling,     // Unknown castling letter, or no rook for a Chess960 right.
+    EnPassant,    // Not '-' or a square.
+    MoveCounters, // Not numbers, or out of range.
+};
+
+const char* fen_error_name(FenError error);
+
+// Loads a FEN into the board in a single pass, without allocating or
+// throwing, as an alternative to Board::setFen for loading large numbers of
+// positions. The move counters are optional (so EPD positions load too), and
+// anything after the last field is ignored. The result is the same board as
+// setFen gives, with the same hash, including dropping en passant squares
+// that no legal move can capture on.
+//
+// On error the board is left in an unspecified (but safe to reload) state.
+// Since Board keeps the FEN given to setFen for set960, switching a board
+// loaded by this to Chess960 reloads the last position set with setFen.
+FenError try_parse_fen(chess::Board& board, std::string_view fen) noexcept;
+
+#endif //FEN_H
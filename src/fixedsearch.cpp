@@ -0,0 +1,298 @@
+#include "fixedsearch.h"
+
+#include "eval.h"
+#include "kpk.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace chess;
+
+static constexpr int PIECE_VALUES[7] = { 100, 300, 300, 500, 900, 0, 0 };
+
+// The largest power of two number of entries that fits in table_mb.
+std::size_t FixedSearcher::table_entries(std::size_t table_mb) {
+    std::size_t count = 1;
+    while (count * 2 * sizeof(Entry) <= table_mb * 1024 * 1024) {
+        count *= 2;
+    }
+    return count;
+}
+
+FixedSearcher::FixedSearcher(std::size_t table_mb) {
+    std::size_t count = table_entries(table_mb);
+    m_table.resize(count);
+    m_mask = count - 1;
+    clear();
+}
+
+void FixedSearcher::clear() {
+    std::fill(m_table.begin(), m_table.end(), Entry {});
+    for (auto& killers: m_killers) {
+        killers.fill(Move::NO_MOVE);
+    }
+}
+
+std::size_t FixedSearcher::table_bytes() const {
+    return m_table.size() * sizeof(Entry);
+}
+
+std::size_t FixedSearcher::table_bytes_for(std::size_t table_mb) {
+    return table_entries(table_mb) * sizeof(Entry);
+}
+
+// Mate scores are stored relative to the node, and read back relative to the root.
+static int score_to_table(int score, int ply) {
+    return score >= MATE_BOUND ? score + ply : score <= -MATE_BOUND ? score - ply : score;
+}
+
+static int score_from_table(int score, int ply) {
+    return score >= MATE_BOUND ? score - ply : score <= -MATE_BOUND ? score + ply : score;
+}
+
+FixedSearchResult FixedSearcher::search(Board& board, const SearchLimits& limits, const std::atomic_bool* stop,
+                                        const IterationCallback& on_iteration) {
+    m_nodes = 0;
+    m_node_limit = limits.nodes;
+    m_start = std::chrono::steady_clock::now();
+    m_time_limit = limits.time_ms;
+    m_stop = stop;
+    m_aborted = false;
+
+    FixedSearchResult result {};
+    int max_depth = limits.depth > 0 ? std::min(limits.depth, MAX_SEARCH_PLY - 1) : MAX_SEARCH_PLY - 1;
+
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        // The first iteration is always completed, so that there is a move.
+        m_abortable = depth > 1;
+        m_root_best = Move::NO_MOVE;
+        int score = negamax(board, depth, 0, -MATE_SCORE, MATE_SCORE);
+        if (m_aborted) {
+            break;
+        }
+        result.best_move = m_root_best;
+        result.score = score;
+        result.depth = depth;
+        result.nodes = m_nodes;
+        result.time_ms = elapsed_ms();
+        if (on_iteration) {
+            on_iteration(result);
+        }
+        if (m_root_best == Move::NO_MOVE || std::abs(score) >= MATE_BOUND) {
+            break;
+        }
+    }
+
+    result.nodes = m_nodes;
+    result.time_ms = elapsed_ms();
+    return result;
+}
+
+int FixedSearcher::quiesce(Board& board) {
+    m_nodes = 0;
+    m_stop = nullptr;
+    m_abortable = false;
+    m_aborted = false;
+    return quiescence(board, 0, -MATE_SCORE, MATE_SCORE);
+}
+
+std::int64_t FixedSearcher::elapsed_ms() const {
+    auto elapsed = std::chrono::steady_clock::now() - m_start;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+bool FixedSearcher::should_abort() {
+    if (m_aborted || !m_abortable) {
+        return m_aborted;
+    }
+    if (m_node_limit && m_nodes >= m_node_limit) {
+        m_aborted = true;
+    }
+    else if ((m_nodes & 1023) == 0) {
+        m_aborted = (m_stop && m_stop->load(std::memory_order_relaxed))
+                 || (m_time_limit && elapsed_ms() >= m_time_limit);
+    }
+    return m_aborted;
+}
+
+void FixedSearcher::order_moves(const Board& board, Movelist& moves, Move tt_move, int ply) const {
+    for (Move& move: moves) {
+        int score = 0;
+        if (move == tt_move) {
+            score = 30000;
+        }
+        else if (move.typeOf() == Move::PROMOTION) {
+            score = 20000 + PIECE_VALUES[int(move.promotionType())];
+        }
+        else if (move.typeOf() == Move::ENPASSANT) {
+            score = 10000 + PIECE_VALUES[0] * 10 - 1;
+        }
+        else if (move.typeOf() != Move::CASTLING && board.at(move.to()) != Piece::NONE) {
+            // Most valuable victim, then least valuable attacker.
+            int victim = PIECE_VALUES[int(board.at(move.to()).type())];
+            int attacker = PIECE_VALUES[int(board.at(move.from()).type())];
+            score = 10000 + victim * 10 - attacker / 100;
+        }
+        else if (move == m_killers[ply][0]) {
+            score = 9000;
+        }
+        else if (move == m_killers[ply][1]) {
+            score = 8999;
+        }
+        move.setScore(std::int16_t(score));
+    }
+
+    // Stable, so that the search doesn't depend on the sort implementation.
+    std::stable_sort(moves.begin(), moves.end(), [](const Move& a, const Move& b) {
+        return a.score() > b.score();
+    });
+}
+
+// Every node is traced once, whichever way it returns: negamax and
+// quiescence record the node around the search of it, and m_node_move is
+// set to the node's best move (if it has one) before returning.
+int FixedSearcher::negamax(Board& board, int depth, int ply, int alpha, int beta) {
+    m_node_move = Move::NO_MOVE;
+    int score = negamax_node(board, depth, ply, alpha, beta);
+    TRACE_NODE(board.hash(), depth, alpha, beta, m_node_move.move(), score);
+    return score;
+}
+
+int FixedSearcher::quiescence(Board& board, int ply, int alpha, int beta) {
+    m_node_move = Move::NO_MOVE;
+    int score = quiescence_node(board, ply, alpha, beta);
+    TRACE_NODE(board.hash(), 0, alpha, beta, m_node_move.move(), score);
+    return score;
+}
+
+int FixedSearcher::negamax_node(Board& board, int depth, int ply, int alpha, int beta) {
+    if (ply > 0) {
+        if (board.isRepetition(1) || board.isHalfMoveDraw() || board.isInsufficientMaterial()) {
+            return 0;
+        }
+        // The bitbase result is exact, so there is nothing left to search.
+        if (is_kpk(board)) {
+            m_nodes++;
+            return evaluate(board);
+        }
+    }
+
+    bool in_check = board.inCheck();
+    if (in_check) {
+        depth++;
+    }
+    // Traced as this node rather than as a child.
+    if (depth <= 0 || ply >= MAX_SEARCH_PLY - 1) {
+        return quiescence_node(board, ply, alpha, beta);
+    }
+
+    m_nodes++;
+    if (ply > 0 && should_abort()) {
+        return 0;
+    }
+
+    Entry& entry = m_table[board.hash() & m_mask];
+    Move tt_move = Move::NO_MOVE;
+    if (entry.key == board.hash()) {
+        tt_move = Move(entry.move);
+        int score = score_from_table(entry.score, ply);
+        if (ply > 0 && entry.depth >= depth
+            && (entry.bound == BOUND_EXACT
+                || (entry.bound == BOUND_LOWER && score >= beta)
+                || (entry.bound == BOUND_UPPER && score <= alpha))) {
+            m_node_move = tt_move;
+            return score;
+        }
+    }
+
+    Movelist moves;
+    movegen::legalmoves(moves, board);
+    if (moves.empty()) {
+        return in_check ? -MATE_SCORE + ply : 0;
+    }
+    order_moves(board, moves, tt_move, ply);
+
+    int original_alpha = alpha;
+    int best_score = -MATE_SCORE;
+    Move best_move = Move::NO_MOVE;
+
+    for (const Move& move: moves) {
+        bool quiet = move.typeOf() == Move::CASTLING
+                  || (board.at(move.to()) == Piece::NONE && move.typeOf() == Move::NORMAL);
+
+        board.makeMove(move);
+        int score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+        board.unmakeMove(move);
+
+        if (m_aborted) {
+            m_node_move = best_move;
+            return best_score;
+        }
+        if (score > best_score) {
+            best_score = score;
+            best_move = move;
+            if (ply == 0) {
+                m_root_best = move;
+            }
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            if (quiet && m_killers[ply][0] != move) {
+                m_killers[ply][1] = m_killers[ply][0];
+                m_killers[ply][0] = move;
+            }
+            break;
+        }
+    }
+
+    entry.key = board.hash();
+    entry.score = std::int16_t(score_to_table(best_score, ply));
+    entry.move = best_move.move();
+    entry.depth = std::int8_t(depth);
+    entry.bound = best_score >= beta ? BOUND_LOWER : best_score > original_alpha ? BOUND_EXACT : BOUND_UPPER;
+    m_node_move = best_move;
+    return best_score;
+}
+
+int FixedSearcher::quiescence_node(Board& board, int ply, int alpha, int beta) {
+    m_nodes++;
+    if (should_abort()) {
+        return 0;
+    }
+
+    int stand_pat = evaluate(board);
+    if (stand_pat >= beta || ply >= MAX_SEARCH_PLY - 1) {
+        return stand_pat;
+    }
+    alpha = std::max(alpha, stand_pat);
+
+    Movelist moves;
+    movegen::legalmoves<movegen::MoveGenType::CAPTURE>(moves, board);
+    order_moves(board, moves, Move::NO_MOVE, ply);
+
+    int best_score = stand_pat;
+    Move best_move = Move::NO_MOVE;
+    for (const Move& move: moves) {
+        board.makeMove(move);
+        int score = -quiescence(board, ply + 1, -beta, -alpha);
+        board.unmakeMove(move);
+
+        if (m_aborted) {
+            m_node_move = best_move;
+            return best_score;
+        }
+        if (score > best_score) {
+            best_score = score;
+            best_move = move;
+            alpha = std::max(alpha, score);
+            if (alpha >= beta) {
+                break;
+            }
+        }
+    }
+    m_node_move = best_move;
+    return best_score;
+}
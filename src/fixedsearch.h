@@ -0,0 +1,111 @@
+#ifndef FIXEDSEARCH_H
+#define FIXEDSEARCH_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+
+// Mate scores are MATE_SCORE minus the number of plies to mate.
+constexpr int MATE_SCORE = 32000;
+constexpr int MATE_BOUND = MATE_SCORE - 1000;
+constexpr int MAX_SEARCH_PLY = 128;
+
+constexpr std::size_t DEFAULT_FIXED_SEARCH_TABLE_MB = 4;
+
+// Limits of a fixed search. Zero means unlimited, so at least one of them
+// should be set. Only the depth and node limits give reproducible results.
+struct SearchLimits {
+    int depth = 0;
+    std::uint64_t nodes = 0;
+    std::int64_t time_ms = 0;
+};
+
+struct FixedSearchResult {
+    chess::Move best_move = chess::Move::NO_MOVE;
+    // From the side to move's point of view.
+    int score = 0;
+    // Depth of the last completed iteration.
+    int depth = 0;
+    std::uint64_t nodes = 0;
+    std::int64_t time_ms = 0;
+};
+
+// Called with the result of every completed iteration.
+using IterationCallback = std::function<void(const FixedSearchResult&)>;
+
+// A small alpha-beta search over eval.h (iterative deepening, transposition
+// table, killer moves and quiescence search) that searches to a fixed depth
+// or node count. It is single-threaded and deterministic, which is what the
+// data tools need: use one instance per thread. It doesn't report anything
+// over UCI and is independent from think().
+class FixedSearcher {
+public:
+    explicit FixedSearcher(std::size_t table_mb = DEFAULT_FIXED_SEARCH_TABLE_MB);
+
+    // The board is restored before returning. The search is also aborted
+    // when stop is set, returning the result of the last completed iteration.
+    FixedSearchResult search(chess::Board& board, const SearchLimits& limits,
+                             const std::atomic_bool* stop = nullptr,
+                             const IterationCallback& on_iteration = {});
+
+    // The quiescence search score of the position, from the side to move's
+    // point of view, searched with a full window and no limits. Only
+    // captures are searched, also when in check.
+    int quiesce(chess::Board& board);
+
+    // Forgets everything learned from previous searches.
+    void clear();
+
+    [[nodiscard]] std::size_t table_bytes() const;
+
+    // The table size of a searcher constructed with table_mb, for memory
+    // accounting before the searchers are created.
+    [[nodiscard]] static std::size_t table_bytes_for(std::size_t table_mb);
+
+private:
+    enum Bound : std::uint8_t {
+        BOUND_NONE,
+        BOUND_UPPER,
+        BOUND_LOWER,
+        BOUND_EXACT,
+    };
+
+    struct Entry {
+        std::uint64_t key;
+        std::int16_t score;
+        std::uint16_t move;
+        std::int8_t depth;
+        Bound bound;
+    };
+
+    std::vector<Entry> m_table;
+    std::uint64_t m_mask;
+    std::array<std::array<chess::Move, 2>, MAX_SEARCH_PLY> m_killers {};
+
+    std::uint64_t m_nodes = 0;
+    std::uint64_t m_node_limit = 0;
+    std::chrono::steady_clock::time_point m_start;
+    std::int64_t m_time_limit = 0;
+    const std::atomic_bool* m_stop = nullptr;
+    bool m_abortable = false;
+    bool m_aborted = false;
+    chess::Move m_root_best = chess::Move::NO_MOVE;
+    // The best move of the node last returned from, for search traces.
+    chess::Move m_node_move = chess::Move::NO_MOVE;
+
+    static std::size_t table_entries(std::size_t table_mb);
+    int negamax(chess::Board& board, int depth, int ply, int alpha, int beta);
+    int quiescence(chess::Board& board, int ply, int alpha, int beta);
+    int negamax_node(chess::Board& board, int depth, int ply, int alpha, int beta);
+    int quiescence_node(chess::Board& board, int ply, int alpha, int beta);
+    void order_moves(const chess::Board& board, chess::Movelist& moves, chess::Move tt_move, int ply) const;
+    bool should_abort();
+    [[nodiscard]] std::int64_t elapsed_ms() const;
+};
+
+#endif //FIXEDSEARCH_H
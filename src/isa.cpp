@@ -0,0 +1,82 @@
+#include "isa.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Entry points of each build variant, see src/CMakeLists.txt.
+extern "C" int engine_main_x86_64(int argc, char* argv[]);
+extern "C" int engine_main_x86_64_v2(int argc, char* argv[]);
+extern "C" int engine_main_x86_64_v3(int argc, char* argv[]);
+extern "C" int engine_main_x86_64_v4(int argc, char* argv[]);
+
+namespace {
+
+struct IsaVariant {
+    const char* name;
+    bool (*supported)();
+    int (*entry)(int, char**);
+};
+
+bool supports_v2() {
+    return __builtin_cpu_supports("popcnt")
+        && __builtin_cpu_supports("ssse3")
+        && __builtin_cpu_supports("sse4.1")
+        && __builtin_cpu_supports("sse4.2");
+}
+
+bool supports_v3() {
+    return supports_v2()
+        && __builtin_cpu_supports("avx")
+        && __builtin_cpu_supports("avx2")
+        && __builtin_cpu_supports("bmi")
+        && __builtin_cpu_supports("bmi2")
+        && __builtin_cpu_supports("f16c")
+        && __builtin_cpu_supports("fma")
+        && __builtin_cpu_supports("lzcnt")
+        && __builtin_cpu_supports("movbe");
+}
+
+bool supports_v4() {
+    return supports_v3()
+        && __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512cd")
+        && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vl");
+}
+
+// Ordered from best to worst.
+const IsaVariant VARIANTS[] = {
+    { "x86-64-v4", supports_v4,              engine_main_x86_64_v4 },
+    { "x86-64-v3", supports_v3,              engine_main_x86_64_v3 },
+    { "x86-64-v2", supports_v2,              engine_main_x86_64_v2 },
+    { "x86-64",    []() { return true; },   engine_main_x86_64 },
+};
+
+} // namespace
+
+int isa_main(int argc, char* argv[]) {
+    __builtin_cpu_init();
+
+    const char* forced = std::getenv("ENGINE_ISA");
+    for (const IsaVariant& variant: VARIANTS) {
+        if (forced && *forced) {
+            if (std::strcmp(forced, variant.name) != 0) {
+                continue;
+            }
+            if (!variant.supported()) {
+                std::cerr << "This CPU does not support " << variant.name << "." << std::endl;
+                return 1;
+            }
+            return variant.entry(argc, argv);
+        }
+
+        if (variant.supported()) {
+            return variant.entry(argc, argv);
+        }
+    }
+
+    std::cerr << "Unknown ENGINE_ISA: " << forced << std::endl;
+    return 1;
+}
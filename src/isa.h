@@ -0,0 +1,11 @@
+#ifndef ISA_H
+#define ISA_H
+
+// Selects the best engine build variant supported by the running CPU
+// and runs it. Only available in multi-ISA builds (ENGINE_MULTI_ISA).
+//
+// The ENGINE_ISA environment variable can be set to a level name
+// (e.g. x86-64-v2) to force a specific variant.
+int isa_main(int argc, char* argv[]);
+
+#endif //ISA_H
@@ -0,0 +1,162 @@
+#include "kpk.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+using namespace chess;
+
+// Positions are seen with white as the side with the pawn, and the pawn on
+// files a to d (the others are mirrored). Ranks 2 to 7 leave 24 pawn squares.
+static constexpr int KPK_POSITIONS = 2 * 24 * 64 * 64;
+
+// Indexed by white king, black king, side to move, pawn file and pawn rank
+// (from the 7th down to the 2nd), from the lowest bits up.
+static int kpk_index(int stm, int white_king, int black_king, int pawn) {
+    return white_king | (black_king << 6) | (stm << 12) | ((pawn & 7) << 13) | ((6 - (pawn >> 3)) << 15);
+}
+
+namespace {
+
+// Results of the positions as they are solved. A position's result is
+// combined from those of its successors with a bitwise or.
+enum KpkResult : std::uint8_t {
+    KPK_INVALID = 0,
+    KPK_UNKNOWN = 1,
+    KPK_DRAW = 2,
+    KPK_WIN = 4,
+};
+
+}
+
+static std::uint64_t king_attacks(int square) {
+    return attacks::king(Square(square)).getBits();
+}
+
+static std::uint64_t pawn_attacks(int square) {
+    return attacks::pawn(Color::WHITE, Square(square)).getBits();
+}
+
+// What can be decided without looking at the moves: illegal positions,
+// promotions that can't be stopped, stalemates and pawns lost right away.
+static KpkResult classify(int stm, int white_king, int black_king, int pawn) {
+    std::uint64_t black_king_bit = 1ull << black_king;
+    int promotion = pawn + 8;
+
+    if (Square::distance(Square(white_king), Square(black_king)) <= 1 || white_king == pawn
+        || black_king == pawn || (stm == 0 && (pawn_attacks(pawn) & black_king_bit))) {
+        return KPK_INVALID;
+    }
+    if (stm == 0 && pawn >> 3 == 6 && white_king != promotion && black_king != promotion
+        && (Square::distance(Square(black_king), Square(promotion)) > 1
+            || Square::distance(Square(white_king), Square(promotion)) == 1)) {
+        return KPK_WIN;
+    }
+    if (stm == 1) {
+        std::uint64_t escapes = king_attacks(black_king) & ~(king_attacks(white_king) | pawn_attacks(pawn));
+        std::uint64_t takes_pawn = king_attacks(black_king) & ~king_attacks(white_king) & (1ull << pawn);
+        if (!escapes || takes_pawn) {
+            return KPK_DRAW;
+        }
+    }
+    return KPK_UNKNOWN;
+}
+
+// The result of an unknown position given those of its successors, or
+// unknown again if they don't decide it yet.
+static KpkResult solve(const std::vector<std::uint8_t>& results, int stm, int white_king, int black_king, int pawn) {
+    int successors = 0;
+
+    if (stm == 0) {
+        std::uint64_t moves = king_attacks(white_king) & ~king_attacks(black_king) & ~(1ull << pawn);
+        while (moves) {
+            int to = __builtin_ctzll(moves);
+            moves &= moves - 1;
+            successors |= results[kpk_index(1, to, black_king, pawn)];
+        }
+
+        // Pushes to the 8th rank are covered by classify().
+        int push = pawn + 8;
+        if (pawn >> 3 < 6 && push != white_king && push != black_king) {
+            successors |= results[kpk_index(1, white_king, black_king, push)];
+            int double_push = push + 8;
+            if (pawn >> 3 == 1 && double_push != white_king && double_push != black_king) {
+                successors |= results[kpk_index(1, white_king, black_king, double_push)];
+            }
+        }
+        return successors & KPK_WIN ? KPK_WIN : successors & KPK_UNKNOWN ? KPK_UNKNOWN : KPK_DRAW;
+    }
+
+    std::uint64_t moves = king_attacks(black_king) & ~king_attacks(white_king) & ~pawn_attacks(pawn);
+    while (moves) {
+        int to = __builtin_ctzll(moves);
+        moves &= moves - 1;
+        successors |= results[kpk_index(0, white_king, to, pawn)];
+    }
+    return successors & KPK_DRAW ? KPK_DRAW : successors & KPK_UNKNOWN ? KPK_UNKNOWN : KPK_WIN;
+}
+
+using KpkBits = std::array<std::uint32_t, KPK_POSITIONS / 32>;
+
+// Classifies every position, then solves the unknown ones from their
+// successors until nothing changes. What is still unknown then is a draw.
+static KpkBits generate_kpk() {
+    std::vector<std::uint8_t> results(KPK_POSITIONS);
+    auto decode = [](int index, int& stm, int& white_king, int& black_king, int& pawn) {
+        white_king = index & 63;
+        black_king = (index >> 6) & 63;
+        stm = (index >> 12) & 1;
+        pawn = ((index >> 13) & 3) + 8 * (6 - (index >> 15));
+    };
+
+    int stm, white_king, black_king, pawn;
+    for (int index = 0; index < KPK_POSITIONS; ++index) {
+        decode(index, stm, white_king, black_king, pawn);
+        results[index] = classify(stm, white_king, black_king, pawn);
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int index = 0; index < KPK_POSITIONS; ++index) {
+            if (results[index] != KPK_UNKNOWN) {
+                continue;
+            }
+            decode(index, stm, white_king, black_king, pawn);
+            KpkResult result = solve(results, stm, white_king, black_king, pawn);
+            if (result != KPK_UNKNOWN) {
+                results[index] = result;
+                changed = true;
+            }
+        }
+    }
+
+    KpkBits bits {};
+    for (int index = 0; index < KPK_POSITIONS; ++index) {
+        if (results[index] == KPK_WIN) {
+            bits[index / 32] |= 1u << (index % 32);
+        }
+    }
+    return bits;
+}
+
+bool is_kpk(const Board& board) {
+    // Pawns on the first or last rank (which setFen accepts) aren't indexed.
+    Bitboard pawns = board.pieces(PieceType::PAWN);
+    return board.occ().count() == 3 && pawns.count() == 1 && !(pawns.getBits() & 0xff000000000000ffull);
+}
+
+bool kpk_is_win(const Board& board) {
+    static const KpkBits bits = generate_kpk();
+
+    int pawn = board.pieces(PieceType::PAWN).lsb();
+    Color strong = board.at(Square(pawn)).color();
+    int white_king = board.kingSq(strong).index();
+    int black_king = board.kingSq(~strong).index();
+    int stm = board.sideToMove() == strong ? 0 : 1;
+
+    // Mirrored so that the pawn is white and on files a to d.
+    int flip = (strong == Color::BLACK ? 56 : 0) ^ ((pawn & 7) >= 4 ? 7 : 0);
+    int index = kpk_index(stm, white_king ^ flip, black_king ^ flip, pawn ^ flip);
+    return bits[index / 32] >> (index % 32) & 1;
+}
@@ -0,0 +1,22 @@
+#ifndef KPK_H
+#define KPK_H
+
+#include "../ext/chess/chess.h"
+
+// King and pawn versus king bitbase: one bit per position (24 KiB in all),
+// telling whether the side with the pawn wins. It is generated by retrograde
+// analysis on first use, which takes about 20 ms, and is shared by all
+// threads.
+//
+// Only queen promotions are considered, which gives the same results as
+// the KPvK table of tools/tbgen, where all promotions are.
+
+// Whether the board holds nothing but the two kings and a single pawn,
+// which is on neither the first nor the last rank.
+bool is_kpk(const chess::Board& board);
+
+// Whether the side with the pawn wins, whatever the move counters. The board
+// must be a KPK position.
+bool kpk_is_win(const chess::Board& board);
+
+#endif //KPK_H
@@ -0,0 +1,231 @@
+#include "latency.h"
+
+#include "../ext/chess/chess.h"
+#include "../ext/libuci/uci.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <streambuf>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+// How long to wait for an expected reply before giving up.
+static constexpr auto REPLY_TIMEOUT = std::chrono::seconds(10);
+
+std::int64_t LatencyResult::percentile(double p) const {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::vector<std::int64_t> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    auto rank = std::size_t(std::ceil(p / 100 * double(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// Engine input. Reads block until the harness writes a line or closes the pipe.
+class InputPipe : public std::streambuf {
+public:
+    void write(const std::string& text) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending += text;
+        }
+        m_cond_var.notify_one();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_cond_var.notify_one();
+    }
+
+protected:
+    int_type underflow() override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond_var.wait(lock, [this] { return !m_pending.empty() || m_closed; });
+        if (m_pending.empty()) {
+            return traits_type::eof();
+        }
+
+        m_buffer.swap(m_pending);
+        m_pending.clear();
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + m_buffer.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond_var;
+    std::string m_pending;
+    std::string m_buffer;
+    bool m_closed = false;
+};
+
+// Engine output. Every complete line is timestamped as soon as it is written.
+class OutputPipe : public std::streambuf {
+public:
+    struct Line {
+        std::string text;
+        Clock::time_point time;
+    };
+
+    // Discards lines until one starting with any of the given prefixes arrives.
+    Line wait_for(std::initializer_list<std::string_view> prefixes) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto deadline = Clock::now() + REPLY_TIMEOUT;
+        while (true) {
+            while (!m_lines.empty()) {
+                Line line = std::move(m_lines.front());
+                m_lines.pop_front();
+                for (std::string_view prefix: prefixes) {
+                    if (std::string_view(line.text).substr(0, prefix.size()) == prefix) {
+                        return line;
+                    }
+                }
+            }
+            if (m_cond_var.wait_until(lock, deadline) == std::cv_status::timeout && m_lines.empty()) {
+                throw std::runtime_error("Timed out waiting for '" + std::string(*prefixes.begin()) + "'.");
+            }
+        }
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            char ch = traits_type::to_char_type(c);
+            xsputn(&ch, 1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override {
+        auto now = Clock::now();
+        bool new_lines = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::streamsize i = 0; i < count; ++i) {
+                if (s[i] != '\n') {
+                    m_partial += s[i];
+                    continue;
+                }
+                m_lines.push_back({ std::move(m_partial), now });
+                m_partial.clear();
+                new_lines = true;
+            }
+        }
+        if (new_lines) {
+            m_cond_var.notify_one();
+        }
+        return count;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond_var;
+    std::deque<Line> m_lines;
+    std::string m_partial;
+};
+
+// A 'position' command with a game of the given length played by random
+// legal moves. The generator is seeded so every run sends the same game.
+static std::string long_position_command(int plies) {
+    std::mt19937_64 rng(plies);
+    while (true) {
+        chess::Board board;
+        std::string command = "position startpos moves";
+        int played = 0;
+        for (; played < plies; ++played) {
+            chess::Movelist moves;
+            chess::movegen::legalmoves(moves, board);
+            if (moves.empty()) {
+                break;
+            }
+            chess::Move move = moves[int(rng() % moves.size())];
+            command += ' ' + chess::uci::moveToUci(move);
+            board.makeMove(move);
+        }
+        if (played == plies) {
+            return command;
+        }
+    }
+}
+
+static std::int64_t micros_between(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+std::vector<LatencyResult> run_latency_bench(int runs) {
+    std::vector<LatencyResult> results = {
+        { "uci -> uciok", {} },
+        { "setoption Hash, isready -> readyok", {} },
+        { "position (300 plies), isready -> readyok", {} },
+        { "go movetime 100 -> first output", {} },
+        { "stop -> bestmove", {} },
+    };
+    const std::string position_command = long_position_command(300);
+
+    InputPipe input;
+    OutputPipe output;
+    std::streambuf* original_input = std::cin.rdbuf(&input);
+    std::streambuf* original_output = std::cout.rdbuf(&output);
+    std::thread loop([] { uci::main_loop(); });
+
+    auto send = [&](const std::string& commands) {
+        auto start = Clock::now();
+        input.write(commands);
+        return start;
+    };
+
+    std::exception_ptr error = nullptr;
+    try {
+        for (int run = 0; run < runs; ++run) {
+            auto start = send("uci\n");
+            results[0].samples.push_back(micros_between(start, output.wait_for({ "uciok" }).time));
+
+            // Alternate between two sizes so that every run actually changes the hash.
+            start = send("setoption name Hash value " + std::string(run % 2 ? "16" : "32") + "\nisready\n");
+            results[1].samples.push_back(micros_between(start, output.wait_for({ "readyok" }).time));
+
+            start = send(position_command + "\nisready\n");
+            results[2].samples.push_back(micros_between(start, output.wait_for({ "readyok" }).time));
+
+            // A search short enough to not report anything still counts,
+            // through its bestmove.
+            start = send("go movetime 100\n");
+            OutputPipe::Line first = output.wait_for({ "info", "bestmove" });
+            results[3].samples.push_back(micros_between(start, first.time));
+            if (first.text.rfind("bestmove", 0) != 0) {
+                output.wait_for({ "bestmove" });
+            }
+
+            send("go infinite\n");
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            start = send("stop\n");
+            results[4].samples.push_back(micros_between(start, output.wait_for({ "bestmove" }).time));
+        }
+    }
+    catch (...) {
+        error = std::current_exception();
+        input.write("stop\n");
+    }
+
+    input.close();
+    loop.join();
+    std::cin.rdbuf(original_input);
+    std::cout.rdbuf(original_output);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return results;
+}
@@ -0,0 +1,25 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr int DEFAULT_LATENCY_RUNS = 100;
+
+// Latencies, in microseconds, of a single protocol exchange
+// over every run of the latency benchmark.
+struct LatencyResult {
+    std::string name;
+    std::vector<std::int64_t> samples;
+
+    // Nearest-rank percentile, p in [0, 100].
+    [[nodiscard]] std::int64_t percentile(double p) const;
+};
+
+// Drives uci::main_loop in-process, with std::cin and std::cout redirected
+// to in-memory pipes, and times the exchanges that matter at very short
+// time controls. The UCI commands must have been registered beforehand.
+std::vector<LatencyResult> run_latency_bench(int runs = DEFAULT_LATENCY_RUNS);
+
+#endif //LATENCY_H
@@ -1,10 +1,13 @@
-#include "../ext/libuci/uci.h"
-
+#ifdef ENGINE_MULTI_ISA
+#include "isa.h"
+#else
 #include "engine.h"
+#endif
 
 int main(int argc, char* argv[]) {
-    Engine e {};
-    e.initialize(argc, argv);
-    uci::main_loop();
-    return 0;
-}
\ No newline at end of file
+#ifdef ENGINE_MULTI_ISA
+    return isa_main(argc, argv);
+#else
+    return engine_main(argc, argv);
+#endif
+}
@@ -0,0 +1,62 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path, Access access) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + ".");
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not stat " + path + ".");
+    }
+    m_size = std::size_t(st.st_size);
+    if (m_size == 0) {
+        // Empty files can't be mapped, but an empty view is just as good.
+        close(fd);
+        return;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + path + ".");
+    }
+    madvise(data, m_size, access == Access::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    m_data = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data && m_fallback.empty()) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+}
+
+#else
+#include <fstream>
+#include <sstream>
+
+MappedFile::MappedFile(const std::string& path, Access) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open " + path + ".");
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    m_fallback = contents.str();
+    m_data = m_fallback.data();
+    m_size = m_fallback.size();
+}
+
+MappedFile::~MappedFile() = default;
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file, memory-mapped where the platform
+// supports it (and read into memory otherwise).
+class MappedFile {
+public:
+    // Hint about how the mapping is going to be read.
+    enum class Access {
+        Sequential,
+        Random,
+    };
+
+    // Throws std::runtime_error if the file can't be opened or mapped.
+    explicit MappedFile(const std::string& path, Access access = Access::Sequential);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const char* data() const { return m_data; }
+    [[nodiscard]] std::size_t size() const { return m_size; }
+    [[nodiscard]] std::string_view view() const { return { m_data, m_size }; }
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    std::string m_fallback;
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,185 @@
+#include "memory.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#include "../ext/libuci/uci.h"
+
+static std::mutex s_mutex;
+static std::map<std::string, TrackedAllocation> s_allocations;
+
+const char* page_backing_name(PageBacking backing) {
+    switch (backing) {
+        case PageBacking::HugeTlb:     return "hugetlb";
+        case PageBacking::Transparent: return "thp";
+        default:                       return "regular pages";
+    }
+}
+
+void track_memory(const std::string& name, std::size_t bytes, PageBacking pages) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_allocations[name] = TrackedAllocation { name, bytes, pages };
+}
+
+void untrack_memory(const std::string& name) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_allocations.erase(name);
+}
+
+std::vector<TrackedAllocation> tracked_memory() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    std::vector<TrackedAllocation> allocations;
+    for (const auto& pair: s_allocations) {
+        allocations.push_back(pair.second);
+    }
+    return allocations;
+}
+
+// Reads a 'Key:   123 kB' line from a /proc file.
+static std::optional<std::size_t> read_proc_kb(const char* path, const std::string& key) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            std::istringstream value(line.substr(key.size()));
+            std::size_t kb;
+            if (value >> kb) {
+                return kb * 1024;
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<std::size_t> resident_memory() {
+    return read_proc_kb("/proc/self/status", "VmRSS:");
+}
+
+std::optional<std::size_t> huge_page_memory() {
+    return read_proc_kb("/proc/self/smaps_rollup", "AnonHugePages:");
+}
+
+// Huge pages are 2 MiB on x86-64 and the usual arm64 configurations.
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+HugePageBuffer::HugePageBuffer(std::size_t bytes, bool use_hugetlb)
+    : m_size(bytes) {
+    std::size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+#ifdef MAP_HUGETLB
+    if (use_hugetlb) {
+        void* data = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            m_data = data;
+            m_mapped = rounded;
+            m_backing = PageBacking::HugeTlb;
+            return;
+        }
+    }
+#else
+    (void) use_hugetlb;
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+    // Transparent huge pages are only used for aligned 2 MiB ranges, so map
+    // an extra huge page and trim the mapping to an aligned start.
+    void* mapping = mmap(nullptr, rounded + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping != MAP_FAILED) {
+        auto start = reinterpret_cast<std::uintptr_t>(mapping);
+        auto aligned = (start + HUGE_PAGE_SIZE - 1) & ~std::uintptr_t(HUGE_PAGE_SIZE - 1);
+        std::size_t head = aligned - start;
+        if (head > 0) {
+            munmap(mapping, head);
+        }
+        munmap(reinterpret_cast<void*>(aligned + rounded), HUGE_PAGE_SIZE - head);
+
+        m_data = reinterpret_cast<void*>(aligned);
+        m_mapped = rounded;
+#ifdef MADV_HUGEPAGE
+        if (madvise(m_data, rounded, MADV_HUGEPAGE) == 0) {
+            m_backing = PageBacking::Transparent;
+        }
+#endif
+        return;
+    }
+#endif
+
+    m_data = ::operator new(rounded, std::align_val_t(HUGE_PAGE_SIZE));
+    std::memset(m_data, 0, rounded);
+}
+
+HugePageBuffer::~HugePageBuffer() {
+    release();
+}
+
+HugePageBuffer::HugePageBuffer(HugePageBuffer&& other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)),
+      m_size(std::exchange(other.m_size, 0)),
+      m_mapped(std::exchange(other.m_mapped, 0)),
+      m_backing(other.m_backing) {}
+
+HugePageBuffer& HugePageBuffer::operator=(HugePageBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_mapped = std::exchange(other.m_mapped, 0);
+        m_backing = other.m_backing;
+    }
+    return *this;
+}
+
+void HugePageBuffer::release() {
+    if (!m_data) {
+        return;
+    }
+#if defined(__unix__) || defined(__APPLE__)
+    if (m_mapped > 0) {
+        munmap(m_data, m_mapped);
+        m_data = nullptr;
+        return;
+    }
+#endif
+    ::operator delete(m_data, std::align_val_t(HUGE_PAGE_SIZE));
+    m_data = nullptr;
+}
+
+static std::string format_mib(std::size_t bytes) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(1) << double(bytes) / (1024 * 1024) << " MiB";
+    return stream.str();
+}
+
+void report_memory() {
+    std::size_t total = 0;
+    for (const TrackedAllocation& allocation: tracked_memory()) {
+        total += allocation.bytes;
+        uci::report_info(uci::info::String("memory " + allocation.name + " "
+                                           + format_mib(allocation.bytes)
+                                           + (allocation.pages != PageBacking::Regular
+                                              ? std::string(" ") + page_backing_name(allocation.pages)
+                                              : std::string())));
+    }
+
+    std::string summary = "memory total " + format_mib(total);
+    if (auto rss = resident_memory()) {
+        summary += " rss " + format_mib(*rss);
+    }
+    if (auto huge = huge_page_memory()) {
+        summary += " hugepages " + format_mib(*huge);
+    }
+    uci::report_info(uci::info::String(summary));
+}
@@ -0,0 +1,80 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What backs the pages of an allocation, from the largest TLB reach down.
+enum class PageBacking {
+    // Reserved huge pages (mmap with MAP_HUGETLB, see vm.nr_hugepages).
+    HugeTlb,
+    // Transparent huge pages requested with madvise(MADV_HUGEPAGE). The
+    // kernel may still use small pages for part of the range.
+    Transparent,
+    Regular,
+};
+
+const char* page_backing_name(PageBacking backing);
+
+// Accounting of the engine's large allocations, so that the memory
+// footprint of a given configuration can be known in advance.
+struct TrackedAllocation {
+    std::string name;
+    std::size_t bytes;
+    PageBacking pages;
+};
+
+// Records (or updates) a named allocation. Owners of large buffers
+// should call this whenever they allocate or resize them.
+void track_memory(const std::string& name, std::size_t bytes, PageBacking pages = PageBacking::Regular);
+
+// Removes a named allocation from the accounting.
+void untrack_memory(const std::string& name);
+
+std::vector<TrackedAllocation> tracked_memory();
+
+// Resident set size of the process, if known.
+std::optional<std::size_t> resident_memory();
+
+// Amount of the process memory backed by transparent huge pages, if known.
+std::optional<std::size_t> huge_page_memory();
+
+// Zero-filled memory for large tables probed at random, such as hash
+// tables, where TLB misses are a large part of the probe cost. Allocated
+// with reserved huge pages if use_hugetlb is set and some are available,
+// otherwise with an mmap advised to use transparent huge pages, and as a
+// last resort (or off Linux) with an aligned operator new. Mapped pages
+// are only committed when first written; the operator new fallback zeroes,
+// and so commits, the whole buffer up front.
+class HugePageBuffer {
+public:
+    HugePageBuffer() = default;
+    // Throws std::bad_alloc if no memory could be allocated.
+    explicit HugePageBuffer(std::size_t bytes, bool use_hugetlb = false);
+    ~HugePageBuffer();
+
+    HugePageBuffer(HugePageBuffer&& other) noexcept;
+    HugePageBuffer& operator=(HugePageBuffer&& other) noexcept;
+    HugePageBuffer(const HugePageBuffer&) = delete;
+    HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+    [[nodiscard]] void* data() const { return m_data; }
+    [[nodiscard]] std::size_t size() const { return m_size; }
+    [[nodiscard]] PageBacking backing() const { return m_backing; }
+
+private:
+    void* m_data = nullptr;
+    std::size_t m_size = 0;
+    // The length of the mapping, 0 if allocated with operator new.
+    std::size_t m_mapped = 0;
+    PageBacking m_backing = PageBacking::Regular;
+
+    void release();
+};
+
+// Prints the tracked allocations, RSS and huge page usage as info strings.
+void report_memory();
+
+#endif //MEMORY_H
@@ -0,0 +1,144 @@
+#include "numa.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static std::atomic_bool s_pinning = false;
+
+// Parses a sysfs CPU or node list, such as '0-3,8-11'.
+static std::vector<int> parse_list(const std::string& text) {
+    std::vector<int> values;
+    std::istringstream stream(text);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        std::size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int value = first; value <= last; ++value) {
+                values.push_back(value);
+            }
+        }
+        catch (const std::exception&) {
+            // Blank lines and trailing separators.
+        }
+    }
+    return values;
+}
+
+static std::vector<int> read_list(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return parse_list(line);
+}
+
+#ifdef __linux__
+static std::vector<int> thread_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+static bool set_thread_cpus(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu: cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+static std::vector<std::vector<int>> read_numa_nodes() {
+    std::vector<std::vector<int>> nodes;
+#ifdef __linux__
+    // Read before any thread is pinned, so this is the process' own mask
+    // (such as the one given by taskset).
+    std::vector<int> allowed = thread_cpus();
+    std::vector<bool> is_allowed;
+    for (int cpu: allowed) {
+        is_allowed.resize(std::max<std::size_t>(is_allowed.size(), cpu + 1));
+        is_allowed[cpu] = true;
+    }
+
+    for (int node: read_list("/sys/devices/system/node/online")) {
+        std::vector<int> cpus;
+        for (int cpu: read_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist")) {
+            if (cpu < int(is_allowed.size()) && is_allowed[cpu]) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(std::move(cpus));
+        }
+    }
+    if (nodes.empty() && !allowed.empty()) {
+        nodes.push_back(std::move(allowed));
+    }
+#endif
+    return nodes;
+}
+
+const std::vector<std::vector<int>>& numa_nodes() {
+    static const std::vector<std::vector<int>> nodes = read_numa_nodes();
+    return nodes;
+}
+
+void set_thread_pinning(bool enabled) {
+    if (enabled) {
+        numa_nodes();
+    }
+    s_pinning = enabled;
+}
+
+bool thread_pinning() {
+    return s_pinning;
+}
+
+ThreadPin::ThreadPin(int index) {
+    TRACE_THREAD(index);
+#ifdef __linux__
+    const std::vector<std::vector<int>>& nodes = numa_nodes();
+    if (!s_pinning || nodes.empty() || index < 0) {
+        return;
+    }
+    int node = index % int(nodes.size());
+    const std::vector<int>& cpus = nodes[node];
+    std::vector<int> previous = thread_cpus();
+    if (set_thread_cpus({ cpus[(index / nodes.size()) % cpus.size()] })) {
+        m_node = node;
+        m_previous_cpus = std::move(previous);
+    }
+#else
+    (void) index;
+#endif
+}
+
+ThreadPin::~ThreadPin() {
+#ifdef __linux__
+    if (m_node >= 0 && !m_previous_cpus.empty()) {
+        set_thread_cpus(m_previous_cpus);
+    }
+#endif
+}
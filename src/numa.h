@@ -0,0 +1,46 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <vector>
+
+// The CPUs of each NUMA node that the process may run on, read from
+// /sys/devices/system/node once. Nodes without such CPUs are left out.
+// Without NUMA information (or off Linux), a single node holding the
+// allowed CPUs, or none at all if those aren't known either.
+const std::vector<std::vector<int>>& numa_nodes();
+
+// Whether ThreadPin pins threads. Off by default, set by the PinThreads
+// option.
+void set_thread_pinning(bool enabled);
+[[nodiscard]] bool thread_pinning();
+
+// Pins the calling thread, the index-th worker of a pool, to a single CPU
+// for its lifetime, if pinning is enabled. Consecutive indices go to
+// different nodes first, then to different CPUs of a node, so threads are
+// spread over the nodes before sharing one. The previous affinity is
+// restored on destruction, for pools that also run work on the calling
+// thread.
+//
+// Memory is placed on the node of the thread that first writes it, so
+// workers should create their search state (tables, killers, buffers)
+// after pinning, on their own thread.
+//
+// Whether pinning or not, the index is also the thread's index in search
+// traces (see TRACE_THREAD), which then match between runs.
+class ThreadPin {
+public:
+    explicit ThreadPin(int index);
+    ~ThreadPin();
+
+    ThreadPin(const ThreadPin&) = delete;
+    ThreadPin& operator=(const ThreadPin&) = delete;
+
+    // The node the thread is pinned to, or -1 if it isn't.
+    [[nodiscard]] int node() const { return m_node; }
+
+private:
+    int m_node = -1;
+    std::vector<int> m_previous_cpus;
+};
+
+#endif //NUMA_H
@@ -0,0 +1,177 @@
+#include "perfcounters.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+std::optional<std::uint64_t> PerfSample::get(PerfEvent event) const {
+    return counts[std::size_t(event)];
+}
+
+std::optional<double> PerfSample::ipc() const {
+    auto cycles = get(PerfEvent::Cycles);
+    auto instructions = get(PerfEvent::Instructions);
+    if (!cycles || !instructions || *cycles == 0) {
+        return std::nullopt;
+    }
+    return double(*instructions) / double(*cycles);
+}
+
+void PerfSample::add(const PerfSample& other) {
+    for (std::size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        counts[i] = counts[i] && other.counts[i]
+                  ? std::optional<std::uint64_t>(*counts[i] + *other.counts[i])
+                  : std::nullopt;
+    }
+}
+
+std::string PerfSample::summary(std::uint64_t nodes) const {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2) << "ipc ";
+    if (auto value = ipc()) {
+        stream << *value;
+    }
+    else {
+        stream << '-';
+    }
+
+    auto per_node = [&](const char* name, PerfEvent event) {
+        stream << ' ' << name << "/node ";
+        if (auto count = get(event); count && nodes) {
+            stream << std::setprecision(3) << double(*count) / double(nodes);
+        }
+        else {
+            stream << '-';
+        }
+    };
+    per_node("l1d-misses", PerfEvent::L1DMisses);
+    per_node("llc-misses", PerfEvent::LLCMisses);
+    per_node("branch-misses", PerfEvent::BranchMisses);
+    return stream.str();
+}
+
+#ifdef __linux__
+
+static perf_event_attr event_attributes(PerfEvent event) {
+    perf_event_attr attr {};
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // The group is read at once. It can still get multiplexed with other
+    // users of the PMU, in which case the counts have to be scaled up.
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    constexpr std::uint64_t READ_MISS = PERF_COUNT_HW_CACHE_OP_READ << 8
+                                      | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    switch (event) {
+        case PerfEvent::Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | READ_MISS;
+            break;
+        case PerfEvent::LLCMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_LL | READ_MISS;
+            break;
+        case PerfEvent::BranchMisses:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+    return attr;
+}
+
+// The events form a single group, led by the first one that can be opened
+// (cycles, normally), so that the kernel schedules them together: ratios
+// such as IPC and misses per node then come from the same time windows.
+// Only the leader is disabled, the others follow it.
+PerfCounters::PerfCounters() {
+    for (std::size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        perf_event_attr attr = event_attributes(PerfEvent(i));
+        attr.disabled = m_leader < 0;
+        m_fds[i] = int(syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0));
+        if (m_leader < 0 && m_fds[i] >= 0) {
+            m_leader = m_fds[i];
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd: m_fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+bool PerfCounters::available() const {
+    return m_leader >= 0;
+}
+
+void PerfCounters::start() {
+    if (m_leader >= 0) {
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample {};
+    if (m_leader < 0) {
+        return sample;
+    }
+    ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // Event count, time enabled, time running, then the value of each event
+    // in the order they joined the group.
+    std::uint64_t values[3 + PERF_EVENT_COUNT];
+    ssize_t size = read(m_leader, values, sizeof(values));
+    if (size < ssize_t(3 * sizeof(std::uint64_t)) || values[2] == 0) {
+        return sample;
+    }
+    std::size_t count = std::min<std::size_t>(values[0], std::size_t(size) / sizeof(std::uint64_t) - 3);
+    double scale = double(values[1]) / double(values[2]);
+
+    std::size_t member = 0;
+    for (std::size_t i = 0; i < PERF_EVENT_COUNT && member < count; ++i) {
+        if (m_fds[i] >= 0) {
+            sample.counts[i] = std::uint64_t(double(values[3 + member]) * scale);
+            member++;
+        }
+    }
+    return sample;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    m_fds.fill(-1);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+bool PerfCounters::available() const {
+    return false;
+}
+
+void PerfCounters::start() {}
+
+PerfSample PerfCounters::stop() {
+    return {};
+}
+
+#endif
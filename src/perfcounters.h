@@ -0,0 +1,57 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Hardware events counted by PerfCounters.
+enum class PerfEvent {
+    Cycles,
+    Instructions,
+    L1DMisses,
+    LLCMisses,
+    BranchMisses,
+};
+
+constexpr std::size_t PERF_EVENT_COUNT = 5;
+
+// Counter values between a start() and a stop(). Events the
+// CPU or kernel can't count are left empty.
+struct PerfSample {
+    std::array<std::optional<std::uint64_t>, PERF_EVENT_COUNT> counts {};
+
+    [[nodiscard]] std::optional<std::uint64_t> get(PerfEvent event) const;
+    [[nodiscard]] std::optional<double> ipc() const;
+
+    // Accumulates another sample. Events missing in either are dropped.
+    void add(const PerfSample& other);
+
+    // IPC and misses per node, formatted for an info string.
+    [[nodiscard]] std::string summary(std::uint64_t nodes) const;
+};
+
+// Hardware performance counters of the calling thread, read through
+// perf_event_open. Only available on Linux; elsewhere (or when the
+// kernel denies access) nothing is counted.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // True if at least one event can be counted.
+    [[nodiscard]] bool available() const;
+
+    void start();
+    PerfSample stop();
+
+private:
+    std::array<int, PERF_EVENT_COUNT> m_fds {};
+    // The group leader's descriptor, -1 if no event could be opened.
+    int m_leader = -1;
+};
+
+#endif //PERFCOUNTERS_H
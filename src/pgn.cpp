@@ -0,0 +1,309 @@
+#include "pgn.h"
+
+#include <array>
+#include <cstring>
+
+using chess::pgn::StreamParserError;
+
+enum CharClass : std::uint8_t {
+    SPACE = 1,
+    DIGIT = 2,
+    // Ends a move token.
+    DELIMITER = 4,
+};
+
+static constexpr std::array<std::uint8_t, 256> CHAR_CLASSES = [] {
+    std::array<std::uint8_t, 256> classes {};
+    for (unsigned char c: { ' ', '\t', '\n', '\r' }) {
+        classes[c] = SPACE | DELIMITER;
+    }
+    for (unsigned char c = '0'; c <= '9'; ++c) {
+        classes[c] = DIGIT;
+    }
+    for (unsigned char c: { '{', '(', ')', ';' }) {
+        classes[c] = DELIMITER;
+    }
+    return classes;
+}();
+
+static bool is(char c, CharClass char_class) {
+    return CHAR_CLASSES[static_cast<unsigned char>(c)] & char_class;
+}
+
+// Skips characters of the given class, returns the first other one.
+static const char* skip(const char* cur, const char* end, CharClass char_class) {
+    while (cur < end && is(*cur, char_class)) {
+        ++cur;
+    }
+    return cur;
+}
+
+// Skips until a character of the given class.
+static const char* skip_until(const char* cur, const char* end, CharClass char_class) {
+    while (cur < end && !is(*cur, char_class)) {
+        ++cur;
+    }
+    return cur;
+}
+
+// Finds a character, or returns the end.
+static const char* find(const char* cur, const char* end, char c) {
+    auto found = static_cast<const char*>(std::memchr(cur, c, std::size_t(end - cur)));
+    return found ? found : end;
+}
+
+static bool starts_with(const char* cur, const char* end, std::string_view prefix) {
+    return std::size_t(end - cur) >= prefix.size() && std::memcmp(cur, prefix.data(), prefix.size()) == 0;
+}
+
+PgnViewParser::PgnViewParser(std::string_view text)
+    : m_text(text), m_cur(text.data()), m_end(text.data() + text.size()) {}
+
+StreamParserError PgnViewParser::readGames(chess::pgn::Visitor& visitor) {
+    m_visitor = &visitor;
+    if (m_text.empty()) {
+        return StreamParserError::NotEnoughData;
+    }
+
+    while (true) {
+        // Games are separated by a blank line, which also tells
+        // apart a game without movetext from the next one.
+        const char* space_start = m_cur;
+        m_cur = skip(m_cur, m_end, SPACE);
+        if (m_cur == m_end) {
+            break;
+        }
+
+        if (*m_cur == '[') {
+            if (m_in_game && !m_in_moves) {
+                const char* first_newline = find(space_start, m_cur, '\n');
+                if (find(first_newline + (first_newline < m_cur), m_cur, '\n') < m_cur) {
+                    end_game();
+                }
+            }
+            else if (m_in_game) {
+                end_game();
+            }
+            if (!m_in_game) {
+                m_in_game = true;
+                m_visitor->skipPgn(false);
+                m_visitor->startPgn();
+            }
+            if (StreamParserError error = parse_header()) {
+                return error;
+            }
+            continue;
+        }
+
+        if (!m_in_game) {
+            // Text outside of a game, which StreamParser ignores as well.
+            m_cur = find(m_cur, m_end, '\n');
+            continue;
+        }
+
+        parse_movetext_token();
+    }
+
+    if (m_in_game) {
+        end_game();
+    }
+    return StreamParserError::None;
+}
+
+StreamParserError PgnViewParser::parse_header() {
+    const char* key_start = ++m_cur;
+    while (m_cur < m_end && !is(*m_cur, SPACE) && *m_cur != '"') {
+        ++m_cur;
+    }
+    std::string_view key(key_start, std::size_t(m_cur - key_start));
+
+    while (m_cur < m_end && (*m_cur == ' ' || *m_cur == '\t')) {
+        ++m_cur;
+    }
+    if (m_cur == m_end || *m_cur != '"') {
+        return StreamParserError::InvalidHeaderMissingClosingQuote;
+    }
+
+    const char* value_start = ++m_cur;
+    bool escaped = false;
+    while (true) {
+        if (m_cur == m_end || *m_cur == '\n') {
+            return StreamParserError::InvalidHeaderMissingClosingQuote;
+        }
+        if (*m_cur == '"' && !escaped) {
+            break;
+        }
+        escaped = *m_cur == '\\' && !escaped;
+        ++m_cur;
+    }
+    std::string_view value(value_start, std::size_t(m_cur - value_start));
+    ++m_cur;
+
+    if (m_cur == m_end || *m_cur != ']') {
+        return StreamParserError::InvalidHeaderMissingClosingBracket;
+    }
+    ++m_cur;
+
+    if (!m_visitor->skip()) {
+        m_visitor->header(key, value);
+    }
+    return StreamParserError::None;
+}
+
+void PgnViewParser::parse_movetext_token() {
+    start_moves();
+
+    switch (*m_cur) {
+        case '{': {
+            std::string_view comment = read_comment();
+            if (!m_has_move) {
+                // A comment before the first move.
+                if (!m_visitor->skip()) {
+                    m_visitor->move("", comment);
+                }
+            }
+            else if (m_comment.empty()) {
+                m_comment = comment;
+            }
+            return;
+        }
+        case ';':
+            m_cur = find(m_cur, m_end, '\n');
+            return;
+        case '(':
+            skip_variation();
+            return;
+        case ')':
+            ++m_cur;
+            return;
+        case '$':
+            m_cur = skip_until(m_cur + 1, m_end, DELIMITER);
+            return;
+        case '*':
+            ++m_cur;
+            end_game();
+            return;
+        case '0':
+        case '1':
+            // Game termination markers.
+            for (std::string_view result: { "1-0", "0-1", "1/2-1/2" }) {
+                if (starts_with(m_cur, m_end, result)) {
+                    m_cur += result.size();
+                    end_game();
+                    return;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Move numbers ('12.' or '12...'), but not castling written with zeros.
+    if (is(*m_cur, DIGIT) && !starts_with(m_cur, m_end, "0-0")) {
+        m_cur = skip(m_cur, m_end, DIGIT);
+        while (m_cur < m_end && *m_cur == '.') {
+            ++m_cur;
+        }
+        return;
+    }
+
+    const char* start = m_cur;
+    m_cur = skip_until(m_cur, m_end, DELIMITER);
+    flush_move();
+    m_move = std::string_view(start, std::size_t(m_cur - start));
+    m_has_move = true;
+}
+
+void PgnViewParser::start_moves() {
+    if (m_in_moves) {
+        return;
+    }
+    m_in_moves = true;
+    if (!m_visitor->skip()) {
+        m_visitor->startMoves();
+    }
+}
+
+void PgnViewParser::flush_move() {
+    if (!m_has_move) {
+        return;
+    }
+    if (!m_visitor->skip()) {
+        m_visitor->move(m_move, m_comment);
+    }
+    m_has_move = false;
+    m_move = {};
+    m_comment = {};
+}
+
+void PgnViewParser::end_game() {
+    start_moves();
+    flush_move();
+    m_visitor->endPgn();
+    m_visitor->skipPgn(false);
+    m_in_game = false;
+    m_in_moves = false;
+}
+
+std::string_view PgnViewParser::read_comment() {
+    const char* start = m_cur + 1;
+    m_cur = find(start, m_end, '}');
+    std::string_view comment(start, std::size_t(m_cur - start));
+    m_cur += m_cur < m_end;
+    return comment;
+}
+
+// Skips a (possibly nested) variation. Comments inside it
+// may contain parentheses, so they are skipped as a whole.
+void PgnViewParser::skip_variation() {
+    int depth = 0;
+    while (m_cur < m_end) {
+        char c = *m_cur;
+        if (c == '{') {
+            read_comment();
+            continue;
+        }
+        ++m_cur;
+        if (c == '(') {
+            ++depth;
+        }
+        else if (c == ')' && --depth == 0) {
+            return;
+        }
+    }
+}
+
+// Whether an '[Event' tag starts at the given position, after a blank line.
+static bool is_game_start(std::string_view text, std::size_t pos) {
+    if (text.compare(pos, 6, "[Event") != 0) {
+        return false;
+    }
+    // Walk back over the previous line, which must be empty.
+    std::size_t newlines = 0;
+    while (pos > 0 && newlines < 2) {
+        char c = text[--pos];
+        if (c == '\n') {
+            ++newlines;
+        }
+        else if (c != '\r') {
+            return false;
+        }
+    }
+    return newlines == 2 || pos == 0;
+}
+
+std::vector<std::string_view> split_pgn(std::string_view text, std::size_t chunk_size) {
+    std::vector<std::string_view> chunks;
+    std::size_t start = 0;
+    while (start < text.size()) {
+        std::size_t end = start + std::max<std::size_t>(chunk_size, 1);
+        while (end < text.size() && !is_game_start(text, end)) {
+            end = text.find("[Event", end + 1);
+            end = std::min(end, text.size());
+        }
+        end = std::min(end, text.size());
+        chunks.push_back(text.substr(start, end - start));
+        start = end;
+    }
+    return chunks;
+}
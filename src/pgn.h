@@ -0,0 +1,122 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+
+// PGN parser over text that is already in memory (usually a MappedFile).
+// Calls the same chess::pgn::Visitor callbacks as chess::pgn::StreamParser,
+// but every string_view it hands out points straight into the text, so
+// nothing is copied. The views are only valid while the text is.
+//
+// Since nothing is copied, a few things differ from StreamParser:
+//  - escaped characters in header values are passed as written ('\"');
+//  - when a move has several comments, only the first is passed;
+//  - carriage returns inside comments are kept.
+class PgnViewParser {
+public:
+    explicit PgnViewParser(std::string_view text);
+
+    chess::pgn::StreamParserError readGames(chess::pgn::Visitor& visitor);
+
+    // Bytes consumed so far.
+    [[nodiscard]] std::size_t position() const { return std::size_t(m_cur - m_text.data()); }
+
+private:
+    std::string_view m_text;
+    const char* m_cur;
+    const char* m_end;
+    chess::pgn::Visitor* m_visitor = nullptr;
+
+    bool m_in_game = false;
+    bool m_in_moves = false;
+    std::string_view m_move;
+    std::string_view m_comment;
+    bool m_has_move = false;
+
+    chess::pgn::StreamParserError parse_header();
+    void parse_movetext_token();
+    void start_moves();
+    void flush_move();
+    void end_game();
+
+    std::string_view read_comment();
+    void skip_variation();
+};
+
+constexpr std::size_t DEFAULT_PGN_CHUNK_SIZE = 16 * 1024 * 1024;
+
+// Cuts PGN text into chunks of roughly the given size, each of which starts
+// at a game: an '[Event' tag at the start of a line, after a blank line.
+std::vector<std::string_view> split_pgn(std::string_view text, std::size_t chunk_size = DEFAULT_PGN_CHUNK_SIZE);
+
+// Parses PGN text on several threads. The text is split with split_pgn,
+// and every chunk is parsed by a fresh visitor from make_visitor(). Once a
+// chunk is done, its visitor is handed to merge(std::unique_ptr<TVisitor>),
+// one call at a time. If ordered, visitors are merged in the order of the
+// chunks, so that the games are seen in the order of the file; otherwise
+// as soon as they finish. Returns the error of the first failed chunk.
+template <typename TVisitor, typename TMakeVisitor, typename TMerge>
+chess::pgn::StreamParserError parse_pgn_parallel(std::string_view text,
+                                                 int threads,
+                                                 TMakeVisitor&& make_visitor,
+                                                 TMerge&& merge,
+                                                 bool ordered = true,
+                                                 std::size_t chunk_size = DEFAULT_PGN_CHUNK_SIZE) {
+    std::vector<std::string_view> chunks = split_pgn(text, chunk_size);
+    std::vector<chess::pgn::StreamParserError> errors(chunks.size());
+
+    std::mutex merge_mutex;
+    std::map<std::size_t, std::unique_ptr<TVisitor>> finished;
+    std::size_t next_merge = 0;
+    std::atomic<std::size_t> next_chunk = 0;
+
+    auto worker = [&]() {
+        std::size_t i;
+        while ((i = next_chunk.fetch_add(1)) < chunks.size()) {
+            std::unique_ptr<TVisitor> visitor = make_visitor();
+            PgnViewParser parser(chunks[i]);
+            errors[i] = parser.readGames(*visitor);
+
+            std::lock_guard<std::mutex> lock(merge_mutex);
+            if (!ordered) {
+                merge(std::move(visitor));
+                continue;
+            }
+            // Hold on to finished chunks until all the ones before them are merged.
+            finished[i] = std::move(visitor);
+            for (auto it = finished.begin(); it != finished.end() && it->first == next_merge; ++next_merge) {
+                merge(std::move(it->second));
+                it = finished.erase(it);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    threads = std::max(1, std::min<int>(threads, int(chunks.size())));
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t: workers) {
+        t.join();
+    }
+
+    for (chess::pgn::StreamParserError error: errors) {
+        if (error) {
+            return error;
+        }
+    }
+    return chess::pgn::StreamParserError::None;
+}
+
+#endif //PGN_H
@@ -0,0 +1,138 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "numa.h"
+
+// Processes items submitted by one producer on worker threads, and hands
+// the results to a writer thread in submission order. At most max_in_flight
+// items are held at once (queued, being processed or waiting to be written),
+// so submit() blocks when the workers or the writer fall behind and memory
+// stays flat whatever the input size.
+//
+// Every worker calls make_processor() once, on its own thread, and keeps the
+// returned function (and whatever state it holds, like a search table) for
+// all the items it processes. Workers are pinned first (see ThreadPin), so
+// that state is allocated on their own node.
+template <typename TItem, typename TResult>
+class OrderedPipeline {
+public:
+    using Processor = std::function<TResult(TItem&)>;
+
+    template <typename TMakeProcessor, typename TWrite>
+    OrderedPipeline(int threads, std::size_t max_in_flight, TMakeProcessor make_processor, TWrite write)
+        : m_max_in_flight(std::max<std::size_t>(max_in_flight, 1)) {
+        for (int i = 0; i < std::max(threads, 1); ++i) {
+            m_workers.emplace_back([this, make_processor, i]() {
+                ThreadPin pin(i);
+                Processor processor = make_processor();
+                work(processor);
+            });
+        }
+        m_writer = std::thread([this, write]() mutable { write_results(write); });
+    }
+
+    OrderedPipeline(const OrderedPipeline&) = delete;
+    OrderedPipeline& operator=(const OrderedPipeline&) = delete;
+
+    ~OrderedPipeline() {
+        finish();
+    }
+
+    void submit(TItem item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_space_ready.wait(lock, [&]() { return m_submitted - m_written < m_max_in_flight; });
+        m_pending.emplace_back(m_submitted++, std::move(item));
+        m_work_ready.notify_one();
+    }
+
+    // Waits until every submitted item has been written.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_finished) {
+                return;
+            }
+            m_finished = true;
+        }
+        m_work_ready.notify_all();
+        m_output_ready.notify_all();
+        for (std::thread& t: m_workers) {
+            t.join();
+        }
+        m_writer.join();
+    }
+
+private:
+    std::size_t m_max_in_flight;
+    std::vector<std::thread> m_workers;
+    std::thread m_writer;
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_ready;
+    std::condition_variable m_output_ready;
+    std::condition_variable m_space_ready;
+    std::deque<std::pair<std::uint64_t, TItem>> m_pending;
+    std::map<std::uint64_t, TResult> m_results;
+    std::uint64_t m_submitted = 0;
+    std::uint64_t m_written = 0;
+    bool m_finished = false;
+
+    void work(Processor& processor) {
+        while (true) {
+            std::pair<std::uint64_t, TItem> item;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_work_ready.wait(lock, [&]() { return !m_pending.empty() || m_finished; });
+                if (m_pending.empty()) {
+                    return;
+                }
+                item = std::move(m_pending.front());
+                m_pending.pop_front();
+            }
+
+            TResult result = processor(item.second);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.emplace(item.first, std::move(result));
+            m_output_ready.notify_one();
+        }
+    }
+
+    template <typename TWrite>
+    void write_results(TWrite& write) {
+        while (true) {
+            TResult result;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_output_ready.wait(lock, [&]() {
+                    return m_results.count(m_written) || (m_finished && m_written == m_submitted);
+                });
+                auto it = m_results.find(m_written);
+                if (it == m_results.end()) {
+                    return;
+                }
+                result = std::move(it->second);
+                m_results.erase(it);
+            }
+
+            write(result);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_written++;
+            m_space_ready.notify_one();
+        }
+    }
+};
+
+#endif //PIPELINE_H
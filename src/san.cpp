@@ -0,0 +1,142 @@
+#include "san.h"
+
+#include <cstring>
+
+using namespace chess;
+
+const char* san_error_name(SanError error) {
+    switch (error) {
+        case SanError::None:      return "none";
+        case SanError::Empty:     return "empty";
+        case SanError::Syntax:    return "syntax";
+        case SanError::NoMatch:   return "no matching move";
+        case SanError::Ambiguous: return "ambiguous";
+    }
+    return "unknown";
+}
+
+static bool is_file(char c) {
+    return c >= 'a' && c <= 'h';
+}
+
+static bool is_rank(char c) {
+    return c >= '1' && c <= '8';
+}
+
+// Piece letters, in PieceType order.
+static constexpr const char* PIECE_LETTERS = "PNBRQK";
+
+static int piece_index(char c) {
+    const char* found = c ? std::strchr(PIECE_LETTERS, c) : nullptr;
+    return found ? int(found - PIECE_LETTERS) : -1;
+}
+
+// Both 'O' and '0' are used for castling in the wild.
+static int castling_side(std::string_view san) {
+    if (san == "O-O" || san == "0-0") {
+        return 1;
+    }
+    if (san == "O-O-O" || san == "0-0-0") {
+        return -1;
+    }
+    return 0;
+}
+
+SanError try_parse_san(const Board& board, std::string_view san, Move& move, Movelist& scratch) noexcept {
+    move = Move::NO_MOVE;
+
+    while (!san.empty() && std::strchr("+#!?", san.back())) {
+        san.remove_suffix(1);
+    }
+    if (san.empty()) {
+        return SanError::Empty;
+    }
+
+    // Castling moves are encoded as the king capturing its own rook,
+    // so the side is told by the direction of the move.
+    if (int side = castling_side(san)) {
+        movegen::legalmoves<movegen::MoveGenType::QUIET>(scratch, board, PieceGenType::KING);
+        for (const Move& m: scratch) {
+            if (m.typeOf() == Move::CASTLING && (m.to() > m.from()) == (side > 0)) {
+                move = m;
+                return SanError::None;
+            }
+        }
+        return SanError::NoMatch;
+    }
+
+    int piece = 0;
+    if (int index = piece_index(san.front()); index >= 0) {
+        piece = index;
+        san.remove_prefix(1);
+    }
+    else if (!is_file(san.front())) {
+        return SanError::Syntax;
+    }
+
+    PieceType promotion = PieceType::NONE;
+    if (piece == 0 && !san.empty() && piece_index(san.back()) > 0) {
+        promotion = PieceType(std::string_view(&san.back(), 1));
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=') {
+            san.remove_suffix(1);
+        }
+    }
+
+    if (san.size() < 2 || !is_file(san[san.size() - 2]) || !is_rank(san.back())) {
+        return SanError::Syntax;
+    }
+    Square to(san.substr(san.size() - 2));
+    san.remove_suffix(2);
+
+    bool capture = !san.empty() && (san.back() == 'x' || san.back() == ':');
+    if (capture) {
+        san.remove_suffix(1);
+    }
+
+    // Whatever is left disambiguates the origin square.
+    int from_file = -1;
+    int from_rank = -1;
+    if (!san.empty() && is_file(san.front())) {
+        from_file = san.front() - 'a';
+        san.remove_prefix(1);
+    }
+    if (!san.empty() && is_rank(san.front())) {
+        from_rank = san.front() - '1';
+        san.remove_prefix(1);
+    }
+    if (!san.empty() || (piece == 0 && capture && from_file < 0)) {
+        return SanError::Syntax;
+    }
+
+    if (capture) {
+        movegen::legalmoves<movegen::MoveGenType::CAPTURE>(scratch, board, 1 << piece);
+    }
+    else {
+        movegen::legalmoves<movegen::MoveGenType::QUIET>(scratch, board, 1 << piece);
+    }
+
+    for (const Move& m: scratch) {
+        if (m.to() != to || m.typeOf() == Move::CASTLING) {
+            continue;
+        }
+        if (from_file >= 0 && int(m.from().file()) != from_file) {
+            continue;
+        }
+        if (from_rank >= 0 && int(m.from().rank()) != from_rank) {
+            continue;
+        }
+        if ((m.typeOf() == Move::PROMOTION) != (promotion != PieceType::NONE)
+            || (promotion != PieceType::NONE && m.promotionType() != promotion)) {
+            continue;
+        }
+
+        if (move != Move::NO_MOVE) {
+            move = Move::NO_MOVE;
+            return SanError::Ambiguous;
+        }
+        move = m;
+    }
+
+    return move == Move::NO_MOVE ? SanError::NoMatch : SanError::None;
+}
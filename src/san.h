@@ -0,0 +1,28 @@
+#ifndef SAN_H
+#define SAN_H
+
+#include <string_view>
+
+#include "../ext/chess/chess.h"
+
+enum class SanError {
+    None,
+    Empty,     // Nothing left after removing check and annotation suffixes.
+    Syntax,    // Not a SAN move.
+    NoMatch,   // No legal move matches it.
+    Ambiguous, // More than one legal move matches it.
+};
+
+const char* san_error_name(SanError error);
+
+// Decodes a SAN move without throwing or allocating, as an alternative to
+// chess::uci::parseSan for replaying large numbers of games. Only moves of
+// the SAN's piece type (and capture or quiet kind) are generated, into the
+// given scratch list, which is best reused across calls. On error, move
+// is set to NO_MOVE.
+SanError try_parse_san(const chess::Board& board,
+                       std::string_view san,
+                       chess::Move& move,
+                       chess::Movelist& scratch) noexcept;
+
+#endif //SAN_H
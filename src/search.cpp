@@ -1,11 +1,52 @@
 #include "search.h"
 
+#include <algorithm>
+#include <chrono>
 #include <ctime>
+#include <optional>
 #include <thread>
+#include <vector>
 
-chess::Move think(const chess::Board& input_board,
-                  const uci::GoArgs& args,
-                  const uci::StopSignal& must_stop) {
+// Keeps the moves leading to the best result according to the tablebases,
+// when they hold the positions after every move. Returns the number of
+// positions probed.
+static std::uint64_t filter_tablebase_moves(const chess::Board& board, const Tablebases& tablebases,
+                                            chess::Movelist& moves) {
+    if (tablebases.size() == 0 || board.occ().count() > tablebases.max_pieces()) {
+        return 0;
+    }
+
+    chess::Board child = board;
+    std::vector<int> results;
+    std::uint64_t hits = 0;
+    for (const chess::Move& move: moves) {
+        child.makeMove(move);
+        std::optional<Wdl> result = tablebases.probe(child);
+        child.unmakeMove(move);
+        // Such as after a double push that can be captured en passant.
+        if (!result) {
+            return hits;
+        }
+        hits++;
+        results.push_back(-int(*result));
+    }
+
+    int best = *std::max_element(results.begin(), results.end());
+    chess::Movelist kept;
+    for (int i = 0; i < moves.size(); ++i) {
+        if (results[i] == best) {
+            kept.add(moves[i]);
+        }
+    }
+    moves = kept;
+    return hits;
+}
+
+SearchResult think(const chess::Board& input_board,
+                   const uci::GoArgs& args,
+                   const uci::StopSignal& must_stop,
+                   TimeLog* time_log,
+                   const Tablebases* tablebases) {
     // The following code contains a demonstration of how to
     // use GoArgs, StopSignal and report_info.
     //
@@ -21,58 +62,104 @@ chess::Move think(const chess::Board& input_board,
 
     // Step 1. We need to know how much time we'll spend searching.
     // This depends on the time control the user requested and how
-    // much time we have left.
-    std::int64_t target_time = INT64_MAX; // Initialize with infinite time.
+    // much time we have left. We use two limits: after the soft limit
+    // we won't start a new iteration, and at the hard limit we abort
+    // the one in progress.
+    std::int64_t soft_limit = INT64_MAX; // Initialize with infinite time.
+    std::int64_t hard_limit = INT64_MAX;
+
+    std::optional<std::int64_t> remaining_time = input_board.sideToMove() == chess::Color::WHITE
+                                               ? args.w_time
+                                               : args.b_time;
+    std::int64_t increment = (input_board.sideToMove() == chess::Color::WHITE
+                              ? args.w_inc
+                              : args.b_inc).value_or(0);
 
     if (args.move_time) {
-        target_time = *args.move_time - 50;
+        soft_limit = hard_limit = std::max<std::int64_t>(*args.move_time - 50, 0);
     }
-    else if (args.w_time && input_board.sideToMove() == chess::Color::WHITE) {
-        std::int64_t remaining_time = *args.w_time;
-        std::int64_t increment = args.w_inc.value_or(0);
-
-        target_time = (remaining_time / 15) + increment;
+    else if (remaining_time) {
+        soft_limit = (*remaining_time / 15) + increment;
+        hard_limit = std::max<std::int64_t>(std::min(soft_limit * 3, *remaining_time - 50), 0);
+        soft_limit = std::min(soft_limit, hard_limit);
     }
-    else if (args.b_time && input_board.sideToMove() == chess::Color::BLACK) {
-        std::int64_t remaining_time = *args.b_time;
-        std::int64_t increment = args.b_inc.value_or(0);
 
-        target_time = (remaining_time / 15) + increment;
-    }
+    auto start_time = std::chrono::steady_clock::now();
+    auto elapsed = [&]() -> std::int64_t {
+        auto now = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
+    };
+
+    TimeLogRecord log {};
+    log.args = args;
+    log.side = input_board.sideToMove();
+    log.soft_limit = soft_limit == INT64_MAX ? -1 : soft_limit;
+    log.hard_limit = hard_limit == INT64_MAX ? -1 : hard_limit;
 
     // Step 2. Start searching for the best move.
     std::srand(std::time(nullptr));
 
     chess::Movelist legal_moves;
     chess::movegen::legalmoves(legal_moves, input_board);
-    chess::Move best_move = legal_moves[std::rand() % legal_moves.size()];
+    std::uint64_t tb_hits = 0;
+    if (tablebases && !legal_moves.empty()) {
+        tb_hits = filter_tablebase_moves(input_board, *tablebases, legal_moves);
+    }
+    chess::Move best_move = legal_moves.empty()
+                          ? chess::Move(chess::Move::NO_MOVE)
+                          : legal_moves[std::rand() % legal_moves.size()];
     int depth = 0;
+    log.stop_reason = legal_moves.empty() ? StopReason::NoMoves : StopReason::Stopped;
 
-    while (!must_stop()) {
-        // Simulate a search by sleeping for a short duration.
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    while (!legal_moves.empty() && !must_stop()) {
+        // Simulate a search by sleeping for a short duration, in small
+        // slices so that we can react to 'stop' and the hard limit.
+        std::int64_t iteration_start = elapsed();
+        while (elapsed() - iteration_start < 1000 && elapsed() < hard_limit && !must_stop()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (must_stop()) {
+            break;
+        }
+        if (elapsed() >= hard_limit) {
+            log.stop_reason = StopReason::HardLimit;
+            break;
+        }
 
         // Increment depth and select a random move as the best move.
         depth++;
-        chess::movegen::legalmoves(legal_moves, input_board);
-        if (legal_moves.empty()) {
-            break; // No legal moves, game over.
-        }
+        chess::Move previous_best_move = best_move;
         best_move = legal_moves[std::rand() % legal_moves.size()];
+        log.iterations.push_back({ depth, elapsed(), best_move != previous_best_move });
 
         // Report search progress to the UCI interface.
         uci::report_info(
             uci::info::Depth(depth),
             uci::info::Score((std::rand() % 4000) - 2000, 1000, 10),
             uci::info::Nodes(depth * 1000), // Simulated node count.
+            uci::info::TbHits(tb_hits),
             uci::info::PV(&best_move, &best_move + 1, [](const auto& move) { return chess::uci::moveToUci(move); })
         );
 
-        // Stop searching if we've reached the target time.
-        if (depth * 1000 >= target_time) {
+        if (args.depth && depth >= *args.depth) {
+            log.stop_reason = StopReason::Depth;
+            break;
+        }
+
+        // Stop searching if we've reached the soft limit.
+        if (elapsed() >= soft_limit) {
+            log.stop_reason = StopReason::SoftLimit;
             break;
         }
     }
 
-    return best_move;
+    std::uint64_t nodes = depth * 1000;
+    if (time_log && time_log->enabled()) {
+        log.elapsed = elapsed();
+        log.nodes = nodes;
+        log.depth = depth;
+        time_log->write(log);
+    }
+
+    return { best_move, nodes };
 }
\ No newline at end of file
@@ -1,11 +1,26 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <cstdint>
+
 #include "../ext/chess/chess.h"
 #include "../ext/libuci/uci.h"
+#include "tablebase.h"
+#include "timelog.h"
+
+struct SearchResult {
+    chess::Move best_move = chess::Move::NO_MOVE;
+    std::uint64_t nodes = 0;
+};
 
-chess::Move think(const chess::Board& board,
+// Searches for the best move. If a time log is given and enabled,
+// a record of the time management decisions is written to it. If
+// tablebases are given and hold the position, only the moves keeping its
+// result are considered.
+SearchResult think(const chess::Board& board,
                   const uci::GoArgs& args,
-                  const uci::StopSignal& must_stop);
+                  const uci::StopSignal& must_stop,
+                  TimeLog* time_log = nullptr,
+                  const Tablebases* tablebases = nullptr);
 
 #endif //SEARCH_H
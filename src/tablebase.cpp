@@ -0,0 +1,339 @@
+#include "tablebase.h"
+
+#include "memory.h"
+#include "../ext/libuci/uci.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace chess;
+
+static constexpr char TB_MAGIC[8] = { 'W', 'D', 'L', 'T', 'A', 'B', 'L', 'E' };
+static constexpr std::string_view TB_PIECES = "QRBNP";
+
+// The a1-d1-d4 triangle, for the white king of pawnless tables.
+static constexpr std::array<int, 10> TRIANGLE = { 0, 1, 2, 3, 9, 10, 11, 18, 19, 27 };
+
+static PieceType tb_piece_type(char letter) {
+    switch (letter) {
+        case 'K': return PieceType::KING;
+        case 'Q': return PieceType::QUEEN;
+        case 'R': return PieceType::ROOK;
+        case 'B': return PieceType::BISHOP;
+        case 'N': return PieceType::KNIGHT;
+        case 'P': return PieceType::PAWN;
+        default:  return PieceType::NONE;
+    }
+}
+
+static int flip_rank(int square) {
+    return square ^ 56;
+}
+
+static int transpose(int square) {
+    return ((square & 7) << 3) | (square >> 3);
+}
+
+bool to_tb_position(const Board& board, TbPosition& position) {
+    Bitboard occupied = board.occ();
+    if (occupied.count() > TB_MAX_PIECES || !board.castlingRights().isEmpty()
+        || board.enpassantSq() != Square::NO_SQ) {
+        return false;
+    }
+    position.count = 0;
+    while (occupied) {
+        int square = occupied.pop();
+        position.pieces[position.count] = board.at(Square(square));
+        position.squares[position.count] = std::uint8_t(square);
+        position.count++;
+    }
+    position.side_to_move = board.sideToMove();
+    return true;
+}
+
+// Whether a side's pieces (without the king, in TB_PIECES order) are
+// stronger than another's: more pieces, or better ones.
+static bool stronger(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return a.size() > b.size();
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i] != b[i]) {
+            return TB_PIECES.find(a[i]) < TB_PIECES.find(b[i]);
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> tablebase_names(int max_pieces) {
+    // Every multiset of up to max_pieces - 2 pieces, in TB_PIECES order.
+    std::vector<std::string> sides = { "" };
+    for (std::size_t i = 0; i < sides.size(); ++i) {
+        if (int(sides[i].size()) >= max_pieces - 2) {
+            continue;
+        }
+        std::size_t first = sides[i].empty() ? 0 : TB_PIECES.find(sides[i].back());
+        for (std::size_t p = first; p < TB_PIECES.size(); ++p) {
+            sides.push_back(sides[i] + TB_PIECES[p]);
+        }
+    }
+
+    std::vector<std::string> names;
+    for (const std::string& white: sides) {
+        for (const std::string& black: sides) {
+            if (white.size() + black.size() == 0 || int(white.size() + black.size()) > max_pieces - 2
+                || stronger(black, white)) {
+                continue;
+            }
+            names.push_back("K" + white + "vK" + black);
+        }
+    }
+
+    // Captures lead to fewer pieces, and promotions to fewer pawns.
+    auto order = [](const std::string& name) {
+        return std::make_pair(name.size(), std::count(name.begin(), name.end(), 'P'));
+    };
+    std::stable_sort(names.begin(), names.end(), [&](const std::string& a, const std::string& b) {
+        return order(a) < order(b);
+    });
+    return names;
+}
+
+std::uint64_t tb_material_key(const TbPosition& position, bool swap) {
+    std::uint64_t key = 0;
+    for (int i = 0; i < position.count; ++i) {
+        int color = int(position.pieces[i].color()) ^ int(swap);
+        key += 1ull << (4 * (color * 6 + int(position.pieces[i].type())));
+    }
+    return key;
+}
+
+TbLayout::TbLayout(std::string_view name)
+    : m_name(name) {
+    std::size_t separator = name.find('v');
+    if (separator == std::string_view::npos || name.size() < 4 || name[0] != 'K'
+        || separator + 1 >= name.size() || name[separator + 1] != 'K') {
+        throw std::invalid_argument("Invalid table name " + m_name + ".");
+    }
+
+    m_pieces[0] = Piece(PieceType::KING, Color::WHITE);
+    m_pieces[1] = Piece(PieceType::KING, Color::BLACK);
+    m_count = 2;
+    for (std::size_t i = 1; i < name.size(); ++i) {
+        if (i == separator || i == separator + 1) {
+            continue;
+        }
+        PieceType type = tb_piece_type(name[i]);
+        if (type == PieceType::NONE || type == PieceType::KING || m_count == TB_MAX_PIECES) {
+            throw std::invalid_argument("Invalid table name " + m_name + ".");
+        }
+        m_pieces[m_count++] = Piece(type, i < separator ? Color::WHITE : Color::BLACK);
+        m_pawns |= type == PieceType::PAWN;
+    }
+
+    m_entries = (m_pawns ? 32 : TRIANGLE.size()) * 2;
+    TbPosition position;
+    position.count = m_count;
+    for (int i = 1; i < m_count; ++i) {
+        m_entries *= 64;
+    }
+    std::copy(m_pieces.begin(), m_pieces.end(), position.pieces.begin());
+    m_key = tb_material_key(position);
+}
+
+std::uint64_t TbLayout::encode(std::array<int, TB_MAX_PIECES> squares, Color side_to_move) const {
+    // Equal pieces are next to each other, and are sorted by square.
+    for (int i = 3; i < m_count; ++i) {
+        for (int j = i; j > 2 && m_pieces[j] == m_pieces[j - 1] && squares[j] < squares[j - 1]; --j) {
+            std::swap(squares[j], squares[j - 1]);
+        }
+    }
+
+    int king = squares[0];
+    std::uint64_t index = m_pawns
+                        ? (king >> 3) * 4 + (king & 7)
+                        : std::find(TRIANGLE.begin(), TRIANGLE.end(), king) - TRIANGLE.begin();
+    for (int i = 1; i < m_count; ++i) {
+        index = index * 64 + squares[i];
+    }
+    return index * 2 + int(side_to_move);
+}
+
+std::uint64_t TbLayout::index(const TbPosition& position) const {
+    std::array<int, TB_MAX_PIECES> squares {};
+    std::array<bool, TB_MAX_PIECES> used {};
+    for (int i = 0; i < m_count; ++i) {
+        for (int j = 0; j < position.count; ++j) {
+            if (!used[j] && position.pieces[j] == m_pieces[i]) {
+                used[j] = true;
+                squares[i] = position.squares[j];
+                break;
+            }
+        }
+    }
+
+    int flip = (squares[0] & 7) > 3 ? 7 : 0;
+    if (!m_pawns && squares[0] >> 3 > 3) {
+        flip ^= 56;
+    }
+    for (int i = 0; i < m_count; ++i) {
+        squares[i] ^= flip;
+    }
+    if (m_pawns) {
+        return encode(squares, position.side_to_move);
+    }
+
+    // With the king on the diagonal, both sides of it give an index: the
+    // smaller one is used.
+    int king = squares[0];
+    std::array<int, TB_MAX_PIECES> transposed {};
+    for (int i = 0; i < m_count; ++i) {
+        transposed[i] = transpose(squares[i]);
+    }
+    if (king >> 3 > (king & 7)) {
+        return encode(transposed, position.side_to_move);
+    }
+    if (king >> 3 == (king & 7)) {
+        return std::min(encode(squares, position.side_to_move), encode(transposed, position.side_to_move));
+    }
+    return encode(squares, position.side_to_move);
+}
+
+bool TbLayout::decode(std::uint64_t index, TbPosition& position) const {
+    if (index >= m_entries) {
+        return false;
+    }
+    position.count = m_count;
+    position.side_to_move = Color(int(index & 1));
+    std::uint64_t rest = index >> 1;
+    for (int i = m_count - 1; i > 0; --i) {
+        position.squares[i] = std::uint8_t(rest % 64);
+        rest /= 64;
+    }
+    position.squares[0] = std::uint8_t(m_pawns ? (rest / 4) * 8 + rest % 4 : TRIANGLE[rest]);
+    std::copy(m_pieces.begin(), m_pieces.end(), position.pieces.begin());
+
+    std::uint64_t occupied = 0;
+    for (int i = 0; i < m_count; ++i) {
+        int square = position.squares[i];
+        bool back_rank = square < 8 || square >= 56;
+        if ((occupied >> square & 1) || (position.pieces[i].type() == PieceType::PAWN && back_rank)) {
+            return false;
+        }
+        occupied |= 1ull << square;
+    }
+    if (Square::distance(Square(position.squares[0]), Square(position.squares[1])) <= 1) {
+        return false;
+    }
+    return this->index(position) == index;
+}
+
+void write_tablebase(const std::string& path, const TbLayout& layout, const std::vector<Wdl>& results) {
+    TbHeader header {};
+    std::memcpy(header.magic, TB_MAGIC, sizeof(TB_MAGIC));
+    header.version = TB_VERSION;
+    header.piece_count = std::uint32_t(layout.piece_count());
+    header.entry_count = layout.entry_count();
+    std::strncpy(header.name, layout.name().c_str(), sizeof(header.name) - 1);
+
+    std::vector<char> data((results.size() + 3) / 4);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        int code = results[i] == Wdl::Win ? 1 : results[i] == Wdl::Loss ? 2 : 0;
+        data[i / 4] = char(data[i / 4] | code << (2 * (i % 4)));
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(data.data(), std::streamsize(data.size()));
+    if (!file) {
+        throw std::runtime_error("Could not write " + path + ".");
+    }
+}
+
+std::size_t Tablebases::open(const std::string& directory) {
+    close();
+    if (directory.empty()) {
+        return 0;
+    }
+
+    std::size_t bytes = 0;
+    for (const std::string& name: tablebase_names()) {
+        std::string path = directory + "/" + name + ".wdl";
+        if (!std::ifstream(path)) {
+            continue;
+        }
+
+        Table table { TbLayout(name), nullptr };
+        try {
+            table.file = std::make_unique<MappedFile>(path, MappedFile::Access::Random);
+        }
+        catch (const std::runtime_error& e) {
+            throw uci::InputError(e.what());
+        }
+
+        TbHeader header {};
+        if (table.file->size() >= sizeof(header)) {
+            std::memcpy(&header, table.file->data(), sizeof(header));
+        }
+        std::uint64_t entries = table.layout.entry_count();
+        if (table.file->size() != sizeof(header) + (entries + 3) / 4
+            || std::memcmp(header.magic, TB_MAGIC, sizeof(TB_MAGIC)) != 0 || header.version != TB_VERSION
+            || header.entry_count != entries || std::string(header.name) != name) {
+            close();
+            throw uci::InputError(path + " is not a valid table.");
+        }
+
+        bytes += table.file->size();
+        m_max_pieces = std::max(m_max_pieces, table.layout.piece_count());
+        std::uint64_t key = table.layout.material_key();
+        m_tables.emplace(key, std::move(table));
+    }
+    track_memory("tablebases", bytes);
+    return m_tables.size();
+}
+
+void Tablebases::close() {
+    m_tables.clear();
+    m_max_pieces = 0;
+    untrack_memory("tablebases");
+}
+
+std::optional<Wdl> Tablebases::probe(const TbPosition& position) const {
+    if (position.count == 2) {
+        return Wdl::Draw;
+    }
+
+    // Tables have the stronger side as white, so the other positions are
+    // probed with the colors swapped.
+    auto it = m_tables.find(tb_material_key(position));
+    TbPosition swapped;
+    const TbPosition* probed = &position;
+    if (it == m_tables.end()) {
+        it = m_tables.find(tb_material_key(position, true));
+        if (it == m_tables.end()) {
+            return std::nullopt;
+        }
+        swapped = position;
+        for (int i = 0; i < position.count; ++i) {
+            swapped.pieces[i] = Piece(position.pieces[i].type(), ~position.pieces[i].color());
+            swapped.squares[i] = std::uint8_t(flip_rank(position.squares[i]));
+        }
+        swapped.side_to_move = ~position.side_to_move;
+        probed = &swapped;
+    }
+
+    std::uint64_t index = it->second.layout.index(*probed);
+    unsigned char byte = static_cast<unsigned char>(it->second.file->data()[sizeof(TbHeader) + index / 4]);
+    int code = (byte >> (2 * (index % 4))) & 3;
+    return code == 1 ? Wdl::Win : code == 2 ? Wdl::Loss : Wdl::Draw;
+}
+
+std::optional<Wdl> Tablebases::probe(const Board& board) const {
+    TbPosition position;
+    if (m_tables.empty() || !to_tb_position(board, position)) {
+        return std::nullopt;
+    }
+    return probe(position);
+}
@@ -0,0 +1,128 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "mapped_file.h"
+
+// Win/draw/loss tables for positions with up to TB_MAX_PIECES pieces
+// (kings included), generated locally by tools/tbgen. Results are for the
+// side to move, with any promotion, and ignore the 50 move rule. Positions
+// with castling rights or an en passant square are not covered, and en
+// passant captures are not considered when generating.
+constexpr int TB_MAX_PIECES = 4;
+
+enum class Wdl : std::int8_t {
+    Loss = -1,
+    Draw = 0,
+    Win = 1,
+};
+
+// A position as a list of pieces, in any order.
+struct TbPosition {
+    int count = 0;
+    std::array<chess::Piece, TB_MAX_PIECES> pieces {};
+    std::array<std::uint8_t, TB_MAX_PIECES> squares {};
+    chess::Color side_to_move = chess::Color::WHITE;
+};
+
+// Fails for positions the tables don't cover.
+bool to_tb_position(const chess::Board& board, TbPosition& position);
+
+// The table names for up to max_pieces pieces (such as 'KQvKR', white's
+// pieces then black's, with the stronger side as white), in an order in
+// which every table only depends on the ones before it.
+std::vector<std::string> tablebase_names(int max_pieces = TB_MAX_PIECES);
+
+// The material of a table and how its positions are indexed: by the white
+// king's square, the other squares and the side to move. Positions are
+// mirrored to have the white king on files a to d, and if there are no
+// pawns also flipped to have it in the a1-d1-d4 triangle. Equal pieces and
+// symmetric positions share an index; the others are left unused.
+class TbLayout {
+public:
+    // Throws std::invalid_argument for names that aren't table names.
+    explicit TbLayout(std::string_view name);
+
+    [[nodiscard]] const std::string& name() const { return m_name; }
+    [[nodiscard]] int piece_count() const { return m_count; }
+    [[nodiscard]] std::uint64_t entry_count() const { return m_entries; }
+    [[nodiscard]] std::uint64_t material_key() const { return m_key; }
+
+    // The position must have the table's material, with the same colors.
+    [[nodiscard]] std::uint64_t index(const TbPosition& position) const;
+
+    // The position at an index. Returns false for unused indices, and for
+    // positions with overlapping pieces, adjacent kings or pawns on the
+    // first or last rank. Whether the side not to move is in check is left
+    // to the caller.
+    bool decode(std::uint64_t index, TbPosition& position) const;
+
+private:
+    std::string m_name;
+    int m_count = 0;
+    bool m_pawns = false;
+    std::uint64_t m_entries = 0;
+    std::uint64_t m_key = 0;
+    // White king, black king, then the others as named.
+    std::array<chess::Piece, TB_MAX_PIECES> m_pieces {};
+
+    [[nodiscard]] std::uint64_t encode(std::array<int, TB_MAX_PIECES> squares, chess::Color side_to_move) const;
+};
+
+// The pieces of each color and type, with swapped colors if swap is set.
+std::uint64_t tb_material_key(const TbPosition& position, bool swap = false);
+
+// Table files are a TbHeader followed by two bits per entry, four entries
+// per byte from the lowest bits up: 0 for a draw, 1 for a win and 2 for a
+// loss. Unused entries are draws.
+struct TbHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t piece_count;
+    std::uint64_t entry_count;
+    char name[16];
+};
+static_assert(sizeof(TbHeader) == 40, "TbHeader is read and written as is.");
+
+constexpr std::uint32_t TB_VERSION = 1;
+
+// Throws std::runtime_error if the file can't be written.
+void write_tablebase(const std::string& path, const TbLayout& layout, const std::vector<Wdl>& results);
+
+// The tables of a directory, memory-mapped and probed in place.
+class Tablebases {
+public:
+    // Maps the tables found in the directory ('<name>.wdl' files), replacing
+    // the current ones, and returns their number. An empty path closes them.
+    // Throws uci::InputError if a table file is invalid.
+    std::size_t open(const std::string& directory);
+    void close();
+
+    [[nodiscard]] std::size_t size() const { return m_tables.size(); }
+    [[nodiscard]] int max_pieces() const { return m_max_pieces; }
+
+    // The result for the side to move, if a table holds the position. Bare
+    // kings are always a draw.
+    [[nodiscard]] std::optional<Wdl> probe(const TbPosition& position) const;
+    [[nodiscard]] std::optional<Wdl> probe(const chess::Board& board) const;
+
+private:
+    struct Table {
+        TbLayout layout;
+        std::unique_ptr<MappedFile> file;
+    };
+
+    std::unordered_map<std::uint64_t, Table> m_tables;
+    int m_max_pieces = 0;
+};
+
+#endif //TABLEBASE_H
@@ -0,0 +1,104 @@
+#include "timelog.h"
+
+#include <optional>
+
+static const char* stop_reason_name(StopReason reason) {
+    switch (reason) {
+        case StopReason::Stopped:   return "stopped";
+        case StopReason::SoftLimit: return "soft";
+        case StopReason::HardLimit: return "hard";
+        case StopReason::Depth:     return "depth";
+        case StopReason::NoMoves:   return "nomoves";
+    }
+    return "unknown";
+}
+
+// Writes an optional value as a CSV field, leaving it empty if unset.
+template <typename T>
+static std::ostream& operator<<(std::ostream& stream, const std::optional<T>& value) {
+    if (value) {
+        stream << *value;
+    }
+    return stream;
+}
+
+static std::optional<std::int64_t> limit_field(std::int64_t limit) {
+    if (limit < 0) {
+        return std::nullopt;
+    }
+    return limit;
+}
+
+std::int64_t TimeLogRecord::overshoot() const {
+    if (stop_reason == StopReason::SoftLimit) {
+        return elapsed - soft_limit;
+    }
+    if (stop_reason == StopReason::HardLimit) {
+        return elapsed - hard_limit;
+    }
+    return 0;
+}
+
+void TimeLog::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    if (path.empty()) {
+        return;
+    }
+
+    bool is_new = true;
+    {
+        std::ifstream existing(path, std::ios::ate | std::ios::binary);
+        is_new = !existing || existing.tellg() <= 0;
+    }
+
+    m_file.open(path, std::ios::app);
+    if (!m_file) {
+        throw uci::InputError("Could not open time log file " + path + ".");
+    }
+
+    if (is_new) {
+        m_file << "side,wtime,winc,btime,binc,movetime,depth_limit,nodes_limit,"
+               << "soft,hard,elapsed,overshoot,nodes,depth,best_move_changes,stop_reason,iterations\n";
+        m_file.flush();
+    }
+}
+
+bool TimeLog::enabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.is_open();
+}
+
+void TimeLog::write(const TimeLogRecord& record) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    int best_move_changes = 0;
+    for (const IterationLog& it: record.iterations) {
+        best_move_changes += it.best_move_changed;
+    }
+
+    const uci::GoArgs& args = record.args;
+    m_file << (record.side == chess::Color::WHITE ? 'w' : 'b') << ','
+           << args.w_time << ',' << args.w_inc << ','
+           << args.b_time << ',' << args.b_inc << ','
+           << args.move_time << ',' << args.depth << ',' << args.nodes << ','
+           << limit_field(record.soft_limit) << ',' << limit_field(record.hard_limit) << ','
+           << record.elapsed << ',' << record.overshoot() << ','
+           << record.nodes << ',' << record.depth << ','
+           << best_move_changes << ',' << stop_reason_name(record.stop_reason) << ',';
+
+    // Per iteration: depth:time:best move changed, separated by spaces.
+    for (std::size_t i = 0; i < record.iterations.size(); ++i) {
+        const IterationLog& it = record.iterations[i];
+        m_file << (i ? " " : "") << it.depth << ':' << it.time_ms << ':' << it.best_move_changed;
+    }
+
+    m_file << '\n';
+    m_file.flush();
+}
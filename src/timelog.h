@@ -0,0 +1,60 @@
+#ifndef TIMELOG_H
+#define TIMELOG_H
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../ext/libuci/uci.h"
+
+// Why a search ended.
+enum class StopReason {
+    Stopped,   // 'stop' was received.
+    SoftLimit, // A new iteration was not started after the soft limit.
+    HardLimit, // The running iteration was aborted at the hard limit.
+    Depth,     // The requested depth was reached.
+    NoMoves,   // The position has no legal moves.
+};
+
+struct IterationLog {
+    int depth;
+    std::int64_t time_ms;
+    bool best_move_changed;
+};
+
+// Everything time management knew and did during a single 'go'.
+// Limits are negative when unlimited.
+struct TimeLogRecord {
+    uci::GoArgs args;
+    chess::Color side = chess::Color::WHITE;
+    std::int64_t soft_limit = -1;
+    std::int64_t hard_limit = -1;
+    std::int64_t elapsed = 0;
+    std::uint64_t nodes = 0;
+    int depth = 0;
+    std::vector<IterationLog> iterations;
+    StopReason stop_reason = StopReason::Stopped;
+
+    // Time spent past the limit that ended the search. Zero if the
+    // search was not ended by a time limit.
+    [[nodiscard]] std::int64_t overshoot() const;
+};
+
+// Opt-in log of time management decisions, written as one CSV line
+// per 'go' so that time allocation can be fitted from real games.
+class TimeLog {
+public:
+    // Starts appending to the given file. An empty path disables the log.
+    void open(const std::string& path);
+    [[nodiscard]] bool enabled() const;
+    void write(const TimeLogRecord& record);
+
+private:
+    mutable std::mutex m_mutex;
+    std::ofstream m_file;
+};
+
+#endif //TIMELOG_H
@@ -0,0 +1,115 @@
+#include "trace.h"
+
+#ifdef ENGINE_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+class TraceRecorder {
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    void record(const TraceRecord& record);
+
+private:
+    void* m_mapping = nullptr;
+    std::size_t m_mapping_size = 0;
+    TraceHeader* m_header = nullptr;
+    TraceRecord* m_records = nullptr;
+    std::atomic<std::uint64_t>* m_written = nullptr;
+};
+
+TraceRecorder::TraceRecorder() {
+    const char* path = std::getenv("ENGINE_TRACE_FILE");
+    const char* records = std::getenv("ENGINE_TRACE_RECORDS");
+    std::string file_name = path && *path ? path : "search.trace";
+    std::uint64_t capacity = records && *records ? std::strtoull(records, nullptr, 10) : (1ULL << 20);
+    capacity = std::max<std::uint64_t>(capacity, 1);
+
+    int fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Could not open trace file " << file_name << "." << std::endl;
+        return;
+    }
+
+    m_mapping_size = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+    if (::ftruncate(fd, off_t(m_mapping_size)) != 0) {
+        std::cerr << "Could not resize trace file " << file_name << "." << std::endl;
+        ::close(fd);
+        return;
+    }
+
+    void* mapping = ::mmap(nullptr, m_mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Could not map trace file " << file_name << "." << std::endl;
+        return;
+    }
+
+    m_mapping = mapping;
+    m_header = static_cast<TraceHeader*>(mapping);
+    m_records = reinterpret_cast<TraceRecord*>(m_header + 1);
+
+    std::memcpy(m_header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    m_header->version = TRACE_VERSION;
+    m_header->record_size = sizeof(TraceRecord);
+    m_header->capacity = capacity;
+    m_header->written = 0;
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+                  "The trace write counter lives in shared memory and must be lock free.");
+    m_written = reinterpret_cast<std::atomic<std::uint64_t>*>(&m_header->written);
+}
+
+TraceRecorder::~TraceRecorder() {
+    if (m_mapping) {
+        ::munmap(m_mapping, m_mapping_size);
+    }
+}
+
+void TraceRecorder::record(const TraceRecord& record) {
+    if (!m_mapping) {
+        return;
+    }
+    std::uint64_t index = m_written->fetch_add(1, std::memory_order_relaxed);
+    m_records[index % m_header->capacity] = record;
+}
+
+TraceRecorder& recorder() {
+    static TraceRecorder s_recorder;
+    return s_recorder;
+}
+
+thread_local std::uint8_t t_thread_index = 0;
+
+} // namespace
+
+void set_trace_thread(int index) {
+    t_thread_index = std::uint8_t(std::clamp(index, 0, 255));
+}
+
+void trace_node(std::uint64_t hash, int depth, int alpha, int beta,
+                std::uint16_t move, std::int64_t result) {
+    TraceRecord record {};
+    record.hash = hash;
+    record.result = result;
+    record.alpha = alpha;
+    record.beta = beta;
+    record.move = move;
+    record.depth = std::int8_t(depth);
+    record.thread = t_thread_index;
+    recorder().record(record);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+// Binary search trace, for finding out why a change altered the
+// bench signature. Enabled at compile time with ENGINE_TRACE (see the
+// CMake option of the same name); otherwise TRACE_NODE compiles to nothing.
+//
+// Records are written to a memory-mapped ring file, named by the
+// ENGINE_TRACE_FILE environment variable (default: search.trace) and
+// holding ENGINE_TRACE_RECORDS records (default: 2^20). Once the ring is
+// full, the oldest records are overwritten. Use the 'tracetool' target
+// to inspect trace files.
+
+constexpr char TRACE_MAGIC[8] = { 'E', 'N', 'G', 'T', 'R', 'A', 'C', 'E' };
+constexpr std::uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t capacity;
+    // Total number of records ever written. Record i is stored at
+    // slot i % capacity.
+    std::uint64_t written;
+    std::uint8_t reserved[32];
+};
+
+// One visited node. Nodes are recorded once their result is known,
+// so children appear before their parents.
+struct TraceRecord {
+    std::uint64_t hash;
+    std::int64_t result;
+    std::int32_t alpha;
+    std::int32_t beta;
+    std::uint16_t move;
+    std::int8_t depth;
+    // The index of the worker within its pool (see TRACE_THREAD), so
+    // that the same thread can be matched across runs. 0 outside pools.
+    std::uint8_t thread;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 64, "TraceHeader must be 64 bytes.");
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must be 32 bytes.");
+
+#ifdef ENGINE_TRACE
+
+void trace_node(std::uint64_t hash, int depth, int alpha, int beta,
+                std::uint16_t move, std::int64_t result);
+
+// Sets the thread index recorded for the calling thread, capped at 255.
+void set_trace_thread(int index);
+
+#define TRACE_NODE(hash, depth, alpha, beta, move, result) \
+    trace_node((hash), (depth), (alpha), (beta), (move), (result))
+#define TRACE_THREAD(index) set_trace_thread(index)
+
+#else
+
+#define TRACE_NODE(hash, depth, alpha, beta, move, result) ((void) 0)
+#define TRACE_THREAD(index) ((void) 0)
+
+#endif
+
+#endif //TRACE_H
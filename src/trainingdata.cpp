@@ -0,0 +1,201 @@
+#include "trainingdata.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef ENGINE_ZLIB
+#include <zlib.h>
+#endif
+
+TrainingRecord make_training_record(const chess::Board& board, int score, int result, chess::Move move) {
+    TrainingRecord record {};
+    record.board = chess::Board::Compact::encode(board);
+    record.score = std::int16_t(std::clamp(score, -32000, 32000));
+    record.result = std::int8_t(result);
+    record.move = move.move();
+    record.ply = std::uint16_t((board.fullMoveNumber() - 1) * 2 + (board.sideToMove() == chess::Color::BLACK));
+    return record;
+}
+
+// Block payload as written to the file.
+static std::string encode_block(const TrainingRecord* records, std::size_t count, bool compress) {
+    const char* raw = reinterpret_cast<const char*>(records);
+    std::size_t raw_size = count * sizeof(TrainingRecord);
+    if (!compress) {
+        return std::string(raw, raw_size);
+    }
+
+#ifdef ENGINE_ZLIB
+    uLongf size = compressBound(uLong(raw_size));
+    std::string data(size, '\0');
+    if (compress2(reinterpret_cast<Bytef*>(data.data()), &size,
+                  reinterpret_cast<const Bytef*>(raw), uLong(raw_size), Z_DEFAULT_COMPRESSION) != Z_OK) {
+        throw std::runtime_error("Could not compress training data.");
+    }
+    data.resize(size);
+    return data;
+#else
+    throw std::runtime_error("This build has no zlib support.");
+#endif
+}
+
+TrainingWriter::TrainingWriter(const std::string& path, bool compress, std::uint32_t block_records)
+    : m_file(path, std::ios::binary | std::ios::trunc),
+      m_path(path),
+      m_compress(compress),
+      m_block_records(std::max<std::uint32_t>(block_records, 1)) {
+    if (!m_file) {
+        throw std::runtime_error("Could not create " + path + ".");
+    }
+#ifndef ENGINE_ZLIB
+    if (compress) {
+        throw std::runtime_error("This build has no zlib support.");
+    }
+#endif
+
+    // Placeholder, rewritten by finish().
+    TrainingHeader header {};
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_buffer.reserve(m_block_records);
+}
+
+TrainingWriter::~TrainingWriter() {
+    try {
+        finish();
+    }
+    catch (const std::exception&) {
+    }
+}
+
+void TrainingWriter::write(const TrainingRecord& record) {
+    m_buffer.push_back(record);
+    if (m_buffer.size() >= m_block_records) {
+        write_block(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+}
+
+void TrainingWriter::write_block(const TrainingRecord* records, std::size_t count) {
+    if (count == 0) {
+        return;
+    }
+    std::string data = encode_block(records, count, m_compress);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finished) {
+        throw std::runtime_error("Training data file " + m_path + " is already finished.");
+    }
+    m_file.write(data.data(), std::streamsize(data.size()));
+    if (!m_file) {
+        throw std::runtime_error("Could not write to " + m_path + ".");
+    }
+    m_index.push_back({ m_offset, std::uint32_t(data.size()), std::uint32_t(count) });
+    m_offset += data.size();
+    m_record_count += count;
+}
+
+void TrainingWriter::finish() {
+    if (!m_buffer.empty()) {
+        write_block(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+
+    TrainingHeader header {};
+    std::memcpy(header.magic, TRAINING_MAGIC, sizeof(header.magic));
+    header.version = TRAINING_VERSION;
+    header.record_size = sizeof(TrainingRecord);
+    header.record_count = m_record_count;
+    header.block_count = m_index.size();
+    header.index_offset = m_offset;
+    header.compression = std::uint32_t(m_compress ? TrainingCompression::Zlib : TrainingCompression::None);
+
+    m_file.write(reinterpret_cast<const char*>(m_index.data()), std::streamsize(m_index.size() * sizeof(TrainingBlock)));
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.close();
+    if (!m_file) {
+        throw std::runtime_error("Could not write to " + m_path + ".");
+    }
+}
+
+std::uint64_t TrainingWriter::record_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_record_count;
+}
+
+TrainingReader::TrainingReader(const std::string& path)
+    : m_file(std::make_unique<MappedFile>(path)), m_path(path) {
+    if (m_file->size() < sizeof(TrainingHeader)) {
+        throw std::runtime_error(path + " is not a training data file.");
+    }
+    std::memcpy(&m_header, m_file->data(), sizeof(m_header));
+    if (std::memcmp(m_header.magic, TRAINING_MAGIC, sizeof(m_header.magic)) != 0) {
+        throw std::runtime_error(path + " is not a training data file.");
+    }
+    if (m_header.version != TRAINING_VERSION || m_header.record_size != sizeof(TrainingRecord)) {
+        throw std::runtime_error(path + " has an unsupported training data version.");
+    }
+    if (m_header.index_offset == 0) {
+        throw std::runtime_error(path + " was not finished.");
+    }
+    if (m_header.index_offset > m_file->size()
+        || (m_file->size() - m_header.index_offset) / sizeof(TrainingBlock) < m_header.block_count) {
+        throw std::runtime_error(path + " is truncated.");
+    }
+#ifndef ENGINE_ZLIB
+    if (compressed()) {
+        throw std::runtime_error(path + " is compressed, but this build has no zlib support.");
+    }
+#endif
+
+    m_index.resize(m_header.block_count);
+    std::memcpy(m_index.data(), m_file->data() + m_header.index_offset, m_index.size() * sizeof(TrainingBlock));
+    for (const TrainingBlock& block: m_index) {
+        if (block.offset + block.size > m_header.index_offset) {
+            throw std::runtime_error(path + " has an invalid block index.");
+        }
+    }
+}
+
+void TrainingReader::read_block(std::size_t block, std::vector<TrainingRecord>& records) const {
+    const TrainingBlock& entry = m_index.at(block);
+    const char* data = m_file->data() + entry.offset;
+    records.resize(entry.records);
+    std::size_t raw_size = std::size_t(entry.records) * sizeof(TrainingRecord);
+
+    if (!compressed()) {
+        if (entry.size != raw_size) {
+            throw std::runtime_error(m_path + " has an invalid block index.");
+        }
+        std::memcpy(records.data(), data, raw_size);
+        return;
+    }
+
+#ifdef ENGINE_ZLIB
+    uLongf size = uLongf(raw_size);
+    if (uncompress(reinterpret_cast<Bytef*>(records.data()), &size,
+                   reinterpret_cast<const Bytef*>(data), uLong(entry.size)) != Z_OK
+        || size != raw_size) {
+        throw std::runtime_error(m_path + " has a corrupted block.");
+    }
+#endif
+}
+
+bool TrainingReader::next(TrainingRecord& record) {
+    while (m_next_record >= m_block.size()) {
+        if (m_next_block >= m_index.size()) {
+            return false;
+        }
+        read_block(m_next_block++, m_block);
+        m_next_record = 0;
+    }
+    record = m_block[m_next_record++];
+    return true;
+}
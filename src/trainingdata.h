@@ -0,0 +1,133 @@
+#ifndef TRAININGDATA_H
+#define TRAININGDATA_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "mapped_file.h"
+
+// Binary training data: fixed-size records grouped into blocks, each block
+// optionally zlib-compressed (if built with ENGINE_ZLIB). The file starts with
+// a TrainingHeader and ends with an index of TrainingBlock entries, so blocks
+// can be read in any order. Everything is stored in native byte order.
+
+constexpr char TRAINING_MAGIC[8] = { 'E', 'N', 'G', 'T', 'R', 'A', 'I', 'N' };
+constexpr std::uint32_t TRAINING_VERSION = 1;
+constexpr std::uint32_t DEFAULT_TRAINING_BLOCK_RECORDS = 16384;
+
+enum class TrainingCompression : std::uint32_t {
+    None = 0,
+    Zlib = 1,
+};
+
+struct TrainingHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t record_count;
+    std::uint64_t block_count;
+    // Zero until the writer is finished.
+    std::uint64_t index_offset;
+    std::uint32_t compression;
+    std::uint32_t reserved0;
+    std::uint8_t reserved[16];
+};
+
+struct TrainingBlock {
+    std::uint64_t offset;
+    // Bytes stored in the file, compressed or not.
+    std::uint32_t size;
+    std::uint32_t records;
+};
+
+// A position with its search score and game result, both from the side to
+// move's point of view. Note that PackedBoard doesn't keep the halfmove clock.
+struct TrainingRecord {
+    chess::PackedBoard board;
+    std::int16_t score;
+    // 1 for a win, 0 for a draw, -1 for a loss.
+    std::int8_t result;
+    std::uint8_t reserved;
+    // Raw chess::Move, or chess::Move::NO_MOVE.
+    std::uint16_t move;
+    std::uint16_t ply;
+};
+
+static_assert(sizeof(TrainingHeader) == 64, "TrainingHeader must be 64 bytes.");
+static_assert(sizeof(TrainingBlock) == 16, "TrainingBlock must be 16 bytes.");
+static_assert(sizeof(TrainingRecord) == 32, "TrainingRecord must be 32 bytes.");
+
+TrainingRecord make_training_record(const chess::Board& board, int score, int result, chess::Move move);
+
+// Streams records into a new training data file. All methods throw
+// std::runtime_error on I/O errors.
+class TrainingWriter {
+public:
+    TrainingWriter(const std::string& path, bool compress,
+                   std::uint32_t block_records = DEFAULT_TRAINING_BLOCK_RECORDS);
+    // Finishes the file, if not done yet. Errors are ignored.
+    ~TrainingWriter();
+    TrainingWriter(const TrainingWriter&) = delete;
+    TrainingWriter& operator=(const TrainingWriter&) = delete;
+
+    // Buffers a record, writing a block whenever the buffer is full.
+    // Not thread-safe: use write_block to write from several threads.
+    void write(const TrainingRecord& record);
+
+    // Writes the given records as one block, right away. Can be called from
+    // several threads at once: blocks are compressed before taking the lock.
+    void write_block(const TrainingRecord* records, std::size_t count);
+
+    // Writes the buffered records, the block index and the final header.
+    void finish();
+
+    [[nodiscard]] std::uint64_t record_count() const;
+
+private:
+    std::ofstream m_file;
+    std::string m_path;
+    bool m_compress;
+    std::uint32_t m_block_records;
+    std::vector<TrainingRecord> m_buffer;
+
+    mutable std::mutex m_mutex;
+    std::uint64_t m_offset = sizeof(TrainingHeader);
+    std::uint64_t m_record_count = 0;
+    std::vector<TrainingBlock> m_index;
+    bool m_finished = false;
+};
+
+// Memory-maps a finished training data file. Throws std::runtime_error
+// if the file is invalid or unfinished.
+class TrainingReader {
+public:
+    explicit TrainingReader(const std::string& path);
+
+    [[nodiscard]] std::uint64_t record_count() const { return m_header.record_count; }
+    [[nodiscard]] std::size_t block_count() const { return m_index.size(); }
+    [[nodiscard]] bool compressed() const { return m_header.compression != std::uint32_t(TrainingCompression::None); }
+
+    // Decodes a block, replacing the contents of records. Thread-safe.
+    void read_block(std::size_t block, std::vector<TrainingRecord>& records) const;
+
+    // Reads the file from start to end, one record at a time. Returns false
+    // once every record has been read.
+    bool next(TrainingRecord& record);
+
+private:
+    std::unique_ptr<MappedFile> m_file;
+    std::string m_path;
+    TrainingHeader m_header {};
+    std::vector<TrainingBlock> m_index;
+
+    std::vector<TrainingRecord> m_block;
+    std::size_t m_next_block = 0;
+    std::size_t m_next_record = 0;
+};
+
+#endif //TRAININGDATA_H
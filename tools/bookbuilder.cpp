@@ -0,0 +1,386 @@
+// Builds an opening book from PGN files.
+//
+// Every position up to the given ply contributes its (Polyglot key, move)
+// pair along with the game result, as wins, draws and losses of the side
+// that moved. Counts are aggregated in memory; once they exceed the memory
+// budget they are spilled to disk as a sorted run, and all runs are merged
+// at the end, so the input can be far larger than RAM.
+//
+// Usage:
+//   bookbuilder [options] <book> <pgn>...
+//
+// Options:
+//   --ply <n>          Deepest ply to record (default 20).
+//   --min-games <n>    Drop moves played in fewer games (default 1).
+//   --memory <mb>      Memory budget for in-memory counts (default 1024).
+//   --format <fmt>     'polyglot' (default) or 'wdl' (see WDL_ENTRY_SIZE).
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../src/book.h"
+#include "../src/fen.h"
+#include "../src/mapped_file.h"
+#include "../src/pgn.h"
+#include "../src/san.h"
+
+// Counts of one move in one position, also the record of spilled runs.
+struct BookRecord {
+    std::uint64_t key;
+    std::uint16_t move;
+    std::uint32_t wins;
+    std::uint32_t draws;
+    std::uint32_t losses;
+
+    [[nodiscard]] std::uint64_t games() const { return std::uint64_t(wins) + draws + losses; }
+    [[nodiscard]] bool operator<(const BookRecord& other) const {
+        return key != other.key ? key < other.key : move < other.move;
+    }
+};
+
+// Entries of the 'wdl' format are 24 bytes, little-endian and sorted by key:
+// key (8), Polyglot move (2), padding (2), wins, draws and losses (4 each).
+constexpr std::size_t WDL_ENTRY_SIZE = 24;
+
+struct Options {
+    int max_ply = 20;
+    std::uint64_t min_games = 1;
+    std::size_t memory_mb = 1024;
+    bool wdl_format = false;
+    std::string output;
+    std::vector<std::string> inputs;
+};
+
+// Rough cost of one entry of the in-memory table, node and bucket included.
+constexpr std::size_t TABLE_ENTRY_BYTES = 64;
+
+class BookCounter {
+public:
+    explicit BookCounter(const Options& options)
+        : m_options(options),
+          m_max_entries(std::max<std::size_t>(options.memory_mb * 1024 * 1024 / TABLE_ENTRY_BYTES, 1)) {}
+
+    ~BookCounter() {
+        for (const std::string& run: m_runs) {
+            std::remove(run.c_str());
+        }
+    }
+
+    void add(std::uint64_t key, std::uint16_t move, int result) {
+        Counts& counts = m_table[{ key, move }];
+        (result > 0 ? counts.wins : result < 0 ? counts.losses : counts.draws)++;
+        if (m_table.size() >= m_max_entries) {
+            spill();
+        }
+    }
+
+    // Merges all runs and the in-memory counts into the book.
+    bool write_book() {
+        std::vector<BookRecord> last_run = sorted_table();
+        std::vector<std::ifstream> runs;
+        for (const std::string& path: m_runs) {
+            runs.emplace_back(path, std::ios::binary);
+        }
+
+        // Heap of the next record of every source; the in-memory one is last.
+        using Head = std::pair<BookRecord, std::size_t>;
+        auto later = [](const Head& a, const Head& b) { return b.first < a.first; };
+        std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+        std::size_t memory_pos = 0;
+
+        auto next = [&](std::size_t source) {
+            BookRecord record {};
+            if (source == runs.size()) {
+                if (memory_pos < last_run.size()) {
+                    heads.emplace(last_run[memory_pos++], source);
+                }
+            }
+            else if (runs[source].read(reinterpret_cast<char*>(&record), sizeof(record))) {
+                heads.emplace(record, source);
+            }
+        };
+        for (std::size_t i = 0; i <= runs.size(); ++i) {
+            next(i);
+        }
+
+        std::ofstream out(m_options.output, std::ios::binary);
+        if (!out) {
+            std::cerr << "Could not open " << m_options.output << "." << std::endl;
+            return false;
+        }
+
+        std::vector<BookRecord> position;
+        while (!heads.empty()) {
+            auto [record, source] = heads.top();
+            heads.pop();
+            next(source);
+
+            if (!position.empty() && position.back().key == record.key && position.back().move == record.move) {
+                position.back().wins += record.wins;
+                position.back().draws += record.draws;
+                position.back().losses += record.losses;
+                continue;
+            }
+            if (!position.empty() && position.back().key != record.key) {
+                write_position(out, position);
+                position.clear();
+            }
+            position.push_back(record);
+        }
+        write_position(out, position);
+
+        std::cout << m_written << " entries written to " << m_options.output
+                  << " (" << m_runs.size() << " runs spilled)" << std::endl;
+        return bool(out);
+    }
+
+private:
+    struct Counts {
+        std::uint32_t wins = 0;
+        std::uint32_t draws = 0;
+        std::uint32_t losses = 0;
+    };
+
+    using TableKey = std::pair<std::uint64_t, std::uint16_t>;
+    struct TableHash {
+        std::size_t operator()(const TableKey& k) const { return k.first ^ (std::uint64_t(k.second) << 48); }
+    };
+
+    const Options& m_options;
+    std::size_t m_max_entries;
+    std::unordered_map<TableKey, Counts, TableHash> m_table;
+    std::vector<std::string> m_runs;
+    std::size_t m_written = 0;
+
+    std::vector<BookRecord> sorted_table() {
+        std::vector<BookRecord> records;
+        records.reserve(m_table.size());
+        for (const auto& [k, c]: m_table) {
+            records.push_back({ k.first, k.second, c.wins, c.draws, c.losses });
+        }
+        std::sort(records.begin(), records.end());
+        m_table.clear();
+        return records;
+    }
+
+    void spill() {
+        std::string path = m_options.output + ".run" + std::to_string(m_runs.size());
+        std::vector<BookRecord> records = sorted_table();
+        std::ofstream run(path, std::ios::binary);
+        run.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(BookRecord)));
+        if (!run) {
+            throw std::runtime_error("Could not write " + path + ".");
+        }
+        m_runs.push_back(path);
+    }
+
+    // Writes the moves of a single position. Polyglot weights are scored
+    // as 2 per win and 1 per draw, scaled down to fit in 16 bits.
+    void write_position(std::ofstream& out, std::vector<BookRecord>& moves) {
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const BookRecord& r) {
+            return r.games() < m_options.min_games;
+        }), moves.end());
+
+        if (m_options.wdl_format) {
+            for (const BookRecord& r: moves) {
+                char data[WDL_ENTRY_SIZE] = {};
+                auto write = [&](int offset, int size, std::uint64_t value) {
+                    for (int i = 0; i < size; ++i, value >>= 8) {
+                        data[offset + i] = char(value & 0xFF);
+                    }
+                };
+                write(0, 8, r.key);
+                write(8, 2, r.move);
+                write(12, 4, r.wins);
+                write(16, 4, r.draws);
+                write(20, 4, r.losses);
+                out.write(data, WDL_ENTRY_SIZE);
+                m_written++;
+            }
+            return;
+        }
+
+        std::uint64_t max_score = 0;
+        for (const BookRecord& r: moves) {
+            max_score = std::max<std::uint64_t>(max_score, 2 * std::uint64_t(r.wins) + r.draws);
+        }
+        for (const BookRecord& r: moves) {
+            std::uint64_t score = 2 * std::uint64_t(r.wins) + r.draws;
+            if (max_score > 0xFFFF) {
+                score = score * 0xFFFF / max_score;
+            }
+            if (score == 0) {
+                continue;
+            }
+            char data[POLYGLOT_ENTRY_SIZE];
+            write_polyglot_entry({ r.key, r.move, std::uint16_t(score), 0 }, data);
+            out.write(data, POLYGLOT_ENTRY_SIZE);
+            m_written++;
+        }
+    }
+};
+
+// Replays games and feeds their opening positions to the counter.
+class BookVisitor : public chess::pgn::Visitor {
+public:
+    BookVisitor(BookCounter& counter, int max_ply)
+        : m_counter(counter), m_max_ply(max_ply) {}
+
+    std::uint64_t games = 0;
+    std::uint64_t skipped = 0;
+    std::uint64_t invalid_fens = 0;
+
+    void startPgn() override {
+        m_board = chess::Board();
+        m_ply = 0;
+        m_result = 2;
+    }
+
+    void header(std::string_view key, std::string_view value) override {
+        if (key == "FEN" && try_parse_fen(m_board, value) != FenError::None) {
+            invalid_fens++;
+            skipPgn(true);
+        }
+        else if (key == "Result") {
+            m_result = value == "1-0" ? 1 : value == "0-1" ? -1 : value == "1/2-1/2" ? 0 : 2;
+        }
+    }
+
+    void startMoves() override {
+        // Games without a result tell nothing about their moves.
+        if (m_result == 2) {
+            skipped++;
+            skipPgn(true);
+        }
+    }
+
+    void move(std::string_view san, std::string_view comment) override {
+        if (san.empty() || m_ply >= m_max_ply) {
+            return;
+        }
+
+        chess::Move move;
+        if (try_parse_san(m_board, san, move, m_scratch) != SanError::None) {
+            skipPgn(true);
+            return;
+        }
+
+        int result = m_board.sideToMove() == chess::Color::WHITE ? m_result : -m_result;
+        m_counter.add(m_board.hash(), to_polyglot_move(move), result);
+        m_board.makeMove(move);
+        m_ply++;
+    }
+
+    void endPgn() override { games++; }
+
+private:
+    BookCounter& m_counter;
+    int m_max_ply;
+    chess::Board m_board;
+    chess::Movelist m_scratch;
+    int m_ply = 0;
+    // 1, 0 or -1 for white, or 2 if unknown.
+    int m_result = 2;
+};
+
+// Parses an option value in [min, max]. Throws std::invalid_argument
+// naming the option otherwise.
+static std::uint64_t parse_number(const std::string& name, const std::string& value,
+                                  std::uint64_t min, std::uint64_t max) {
+    std::uint64_t number = 0;
+    std::size_t end = 0;
+    try {
+        // stoull accepts a leading minus sign, and wraps the value around.
+        if (value.empty() || value[0] == '-') {
+            throw std::invalid_argument(value);
+        }
+        number = std::stoull(value, &end);
+    }
+    catch (const std::exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size() || number < min || number > max) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value
+                                    + " (expected " + std::to_string(min) + " to " + std::to_string(max) + ").");
+    }
+    return number;
+}
+
+// Returns false on a usage error. Throws std::invalid_argument on invalid
+// option values.
+static bool parse_options(int argc, char* argv[], Options& options) {
+    int i = 1;
+    for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; i += 2) {
+        std::string name = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[i + 1];
+        if (name == "--ply") {
+            options.max_ply = int(parse_number(name, value, 1, 1000));
+        }
+        else if (name == "--min-games") {
+            options.min_games = parse_number(name, value, 1, UINT32_MAX);
+        }
+        else if (name == "--memory") {
+            options.memory_mb = parse_number(name, value, 1, 1024 * 1024);
+        }
+        else if (name == "--format" && (value == "polyglot" || value == "wdl")) {
+            options.wdl_format = value == "wdl";
+        }
+        else {
+            return false;
+        }
+    }
+    if (argc - i < 2) {
+        return false;
+    }
+    options.output = argv[i];
+    options.inputs.assign(argv + i + 1, argv + argc);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    bool parsed = false;
+    try {
+        parsed = parse_options(argc, argv, options);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+    }
+    if (!parsed) {
+        std::cerr << "Usage:\n"
+                  << "  bookbuilder [--ply n] [--min-games n] [--memory mb] [--format polyglot|wdl] <book> <pgn>...\n";
+        return 1;
+    }
+
+    try {
+        BookCounter counter(options);
+        BookVisitor visitor(counter, options.max_ply);
+        for (const std::string& input: options.inputs) {
+            MappedFile file(input);
+            PgnViewParser parser(file.view());
+            if (auto error = parser.readGames(visitor)) {
+                std::cerr << input << ": " << error.message() << std::endl;
+                return 1;
+            }
+        }
+        std::cout << visitor.games << " games read, " << visitor.skipped << " without a result, "
+                  << visitor.invalid_fens << " with an invalid FEN" << std::endl;
+        return counter.write_book() ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
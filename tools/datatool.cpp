@@ -0,0 +1,374 @@
+// Inspects and converts binary training data files (see src/trainingdata.h).
+//
+// Usage:
+//   datatool info <data>
+//       Prints the record and block counts and the size per record.
+//   datatool dump <data> [block]
+//       Prints the records of the whole file, or of a single block, as text.
+//   datatool convert [--compress] <text> <data>
+//       Converts a text dataset to binary.
+//   datatool filter [options] <output> <data>...
+//       Drops positions in check or with a capture as best move, and those out
+//       of the given bounds, then removes duplicate positions. Options:
+//         --max-score <cp>   Drop positions scored beyond this (default: none).
+//         --min-ply <n>      Drop positions before this ply (default 0).
+//         --max-ply <n>      Drop positions after this ply (default: none).
+//         --memory <mb>      Memory budget for deduplication (default 1024).
+//         --compress         Compress the output.
+//
+// The text format has one position per line: '<fen> | <score> | <wdl> [| <move>]',
+// with the score in centipawns and the result (1.0, 0.5 or 0.0) both from white's
+// point of view, and the best move in UCI notation.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../src/fen.h"
+#include "../src/trainingdata.h"
+
+static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+static std::vector<std::string_view> split_fields(std::string_view line) {
+    std::vector<std::string_view> fields;
+    std::size_t start = 0;
+    while (true) {
+        std::size_t end = line.find('|', start);
+        fields.push_back(trim(line.substr(start, end - start)));
+        if (end == std::string_view::npos) {
+            return fields;
+        }
+        start = end + 1;
+    }
+}
+
+static void print_record(const TrainingRecord& record) {
+    chess::Board board = chess::Board::Compact::decode(record.board);
+    bool white = board.sideToMove() == chess::Color::WHITE;
+
+    // PackedBoard has no move counters; rebuild the fullmove number from the ply.
+    std::string fen = board.getFen(false);
+    fen += " 0 " + std::to_string(record.ply / 2 + 1);
+
+    const char* wdl = record.result == 0 ? "0.5" : (record.result > 0) == white ? "1.0" : "0.0";
+    std::cout << fen << " | " << (white ? record.score : -record.score) << " | " << wdl;
+    if (record.move != chess::Move::NO_MOVE) {
+        std::cout << " | " << chess::uci::moveToUci(chess::Move(record.move));
+    }
+    std::cout << '\n';
+}
+
+static int info(const std::string& path) {
+    TrainingReader reader(path);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    double size = double(file.tellg());
+    std::cout << "records:     " << reader.record_count() << '\n'
+              << "blocks:      " << reader.block_count() << '\n'
+              << "compression: " << (reader.compressed() ? "zlib" : "none") << '\n'
+              << "bytes/record " << (reader.record_count() ? size / double(reader.record_count()) : 0.0) << '\n';
+
+    // Time a full sequential read, as a training loader would do it.
+    auto start = std::chrono::steady_clock::now();
+    std::uint64_t count = 0;
+    std::int64_t checksum = 0;
+    TrainingRecord record {};
+    while (reader.next(record)) {
+        count++;
+        checksum += record.score;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "read:        " << std::uint64_t(double(count) / std::max(seconds, 1e-9))
+              << " records/s (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
+
+static int dump(const std::string& path, const char* block) {
+    TrainingReader reader(path);
+    std::vector<TrainingRecord> records;
+    std::size_t first = block ? std::stoull(block) : 0;
+    std::size_t last = block ? first + 1 : reader.block_count();
+    if (first >= reader.block_count()) {
+        std::cerr << "No block " << first << " in " << path << "." << std::endl;
+        return 1;
+    }
+    for (std::size_t i = first; i < last; ++i) {
+        reader.read_block(i, records);
+        for (const TrainingRecord& record: records) {
+            print_record(record);
+        }
+    }
+    return 0;
+}
+
+static int convert(const std::string& input, const std::string& output, bool compress) {
+    std::ifstream in(input);
+    if (!in) {
+        std::cerr << "Could not open " << input << "." << std::endl;
+        return 1;
+    }
+
+    TrainingWriter writer(output, compress);
+    chess::Board board;
+    std::string line;
+    std::uint64_t line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        std::vector<std::string_view> fields = split_fields(line);
+        if (fields.size() == 1 && fields[0].empty()) {
+            continue;
+        }
+        if (fields.size() < 3) {
+            std::cerr << input << ":" << line_number << ": invalid line." << std::endl;
+            return 1;
+        }
+        if (FenError error = try_parse_fen(board, fields[0]); error != FenError::None) {
+            std::cerr << input << ":" << line_number << ": invalid FEN (" << fen_error_name(error) << ")." << std::endl;
+            return 1;
+        }
+
+        bool white = board.sideToMove() == chess::Color::WHITE;
+        int score = std::stoi(std::string(fields[1]));
+        int result = fields[2] == "0.5" || fields[2] == "1/2-1/2" ? 0
+                   : fields[2] == "1.0" || fields[2] == "1" || fields[2] == "1-0" ? 1
+                   : -1;
+        chess::Move move = fields.size() > 3 ? chess::uci::uciToMove(board, std::string(fields[3])) : chess::Move::NO_MOVE;
+
+        writer.write(make_training_record(board, white ? score : -score, white ? result : -result, move));
+    }
+    writer.finish();
+    std::cout << writer.record_count() << " records written to " << output << std::endl;
+    return 0;
+}
+
+struct FilterOptions {
+    int max_score = std::numeric_limits<int>::max();
+    int min_ply = 0;
+    int max_ply = std::numeric_limits<int>::max();
+    std::size_t memory_mb = 1024;
+    bool compress = false;
+};
+
+// Record of the shard files: the position's hash, so it isn't decoded twice.
+struct ShardRecord {
+    std::uint64_t hash;
+    TrainingRecord record;
+};
+
+// Rough cost of one position during deduplication: the record itself and
+// its entry in the hash set.
+constexpr std::size_t DEDUP_BYTES_PER_RECORD = sizeof(ShardRecord) + 32;
+
+static bool is_capture(const chess::Board& board, chess::Move move) {
+    return move.typeOf() == chess::Move::ENPASSANT
+        || (move.typeOf() != chess::Move::CASTLING && board.at(move.to()) != chess::Piece::NONE);
+}
+
+// Filters the positions into shards by hash, so that duplicates end up in the
+// same shard, then deduplicates each shard on its own. Shards are sized so
+// that each of them fits in the memory budget. The output is ordered by
+// shard, which shuffles positions from different games together.
+static int filter(const std::vector<std::string>& inputs, const std::string& output, const FilterOptions& options) {
+    std::uint64_t total = 0;
+    for (const std::string& input: inputs) {
+        total += TrainingReader(input).record_count();
+    }
+    std::uint64_t budget = std::max<std::uint64_t>(options.memory_mb * 1024 * 1024, 1);
+    std::size_t shard_count = std::size_t(std::max<std::uint64_t>((total * DEDUP_BYTES_PER_RECORD + budget - 1) / budget, 1));
+
+    std::vector<std::string> shard_paths;
+    std::vector<std::ofstream> shards;
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        shard_paths.push_back(output + ".shard" + std::to_string(i));
+        shards.emplace_back(shard_paths.back(), std::ios::binary | std::ios::trunc);
+        if (!shards.back()) {
+            throw std::runtime_error("Could not create " + shard_paths.back() + ".");
+        }
+    }
+    auto remove_shards = [&]() {
+        shards.clear();
+        for (const std::string& path: shard_paths) {
+            std::remove(path.c_str());
+        }
+    };
+
+    std::uint64_t in_check = 0;
+    std::uint64_t captures = 0;
+    std::uint64_t out_of_bounds = 0;
+    std::uint64_t duplicates = 0;
+
+    try {
+        TrainingRecord record {};
+        for (const std::string& input: inputs) {
+            TrainingReader reader(input);
+            while (reader.next(record)) {
+                if (std::abs(int(record.score)) > options.max_score
+                    || record.ply < options.min_ply || record.ply > options.max_ply) {
+                    out_of_bounds++;
+                    continue;
+                }
+                chess::Board board = chess::Board::Compact::decode(record.board);
+                if (board.inCheck()) {
+                    in_check++;
+                    continue;
+                }
+                if (record.move != chess::Move::NO_MOVE && is_capture(board, chess::Move(record.move))) {
+                    captures++;
+                    continue;
+                }
+
+                ShardRecord shard_record { board.hash(), record };
+                shards[shard_record.hash % shard_count].write(reinterpret_cast<const char*>(&shard_record),
+                                                              sizeof(shard_record));
+            }
+        }
+        for (std::ofstream& shard: shards) {
+            shard.close();
+            if (!shard) {
+                throw std::runtime_error("Could not write the shard files.");
+            }
+        }
+
+        TrainingWriter writer(output, options.compress);
+        std::vector<ShardRecord> shard_records;
+        std::unordered_set<std::uint64_t> seen;
+        for (const std::string& path: shard_paths) {
+            std::ifstream shard(path, std::ios::binary | std::ios::ate);
+            shard_records.resize(std::size_t(shard.tellg()) / sizeof(ShardRecord));
+            shard.seekg(0);
+            shard.read(reinterpret_cast<char*>(shard_records.data()),
+                       std::streamsize(shard_records.size() * sizeof(ShardRecord)));
+
+            seen.clear();
+            seen.reserve(shard_records.size());
+            for (const ShardRecord& r: shard_records) {
+                if (seen.insert(r.hash).second) {
+                    writer.write(r.record);
+                }
+                else {
+                    duplicates++;
+                }
+            }
+        }
+        writer.finish();
+
+        std::cout << "read:          " << total << '\n'
+                  << "in check:      " << in_check << '\n'
+                  << "captures:      " << captures << '\n'
+                  << "out of bounds: " << out_of_bounds << '\n'
+                  << "duplicates:    " << duplicates << '\n'
+                  << "written:       " << writer.record_count() << " (" << shard_count << " shards)" << std::endl;
+    }
+    catch (...) {
+        remove_shards();
+        throw;
+    }
+    remove_shards();
+    return 0;
+}
+
+// Parses an option value in [min, max]. Throws std::invalid_argument
+// naming the option otherwise.
+static int parse_number(const std::string& name, const std::string& value, int min, int max) {
+    int number = 0;
+    std::size_t end = 0;
+    try {
+        number = std::stoi(value, &end);
+    }
+    catch (const std::exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size() || number < min || number > max) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value + ".");
+    }
+    return number;
+}
+
+// Returns false on a usage error. Throws std::invalid_argument on invalid
+// option values.
+static bool parse_filter_options(std::vector<std::string>& args, FilterOptions& options) {
+    std::size_t i = 1;
+    for (; i < args.size() && args[i].rfind("--", 0) == 0; ++i) {
+        if (args[i] == "--compress") {
+            options.compress = true;
+            continue;
+        }
+        if (i + 1 >= args.size()) {
+            return false;
+        }
+        const std::string& name = args[i];
+        const std::string& value = args[i + 1];
+        constexpr int MAX = std::numeric_limits<int>::max();
+        if (name == "--max-score") {
+            options.max_score = parse_number(name, value, 0, MAX);
+        }
+        else if (name == "--min-ply") {
+            options.min_ply = parse_number(name, value, 0, MAX);
+        }
+        else if (name == "--max-ply") {
+            options.max_ply = parse_number(name, value, 0, MAX);
+        }
+        else if (name == "--memory") {
+            options.memory_mb = std::size_t(parse_number(name, value, 1, 1024 * 1024));
+        }
+        else {
+            return false;
+        }
+        ++i;
+    }
+    args.erase(args.begin() + 1, args.begin() + std::ptrdiff_t(i));
+    return args.size() >= 3;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    bool compress = false;
+    if (args.size() >= 2 && args[0] == "convert" && args[1] == "--compress") {
+        compress = true;
+        args.erase(args.begin() + 1);
+    }
+
+    try {
+        if (args.size() == 2 && args[0] == "info") {
+            return info(args[1]);
+        }
+        if ((args.size() == 2 || args.size() == 3) && args[0] == "dump") {
+            return dump(args[1], args.size() == 3 ? argv[argc - 1] : nullptr);
+        }
+        if (args.size() == 3 && args[0] == "convert") {
+            return convert(args[1], args[2], compress);
+        }
+        FilterOptions filter_options;
+        if (!args.empty() && args[0] == "filter" && parse_filter_options(args, filter_options)) {
+            return filter(std::vector<std::string>(args.begin() + 2, args.end()), args[1], filter_options);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cerr << "Usage:\n"
+              << "  datatool info <data>\n"
+              << "  datatool dump <data> [block]\n"
+              << "  datatool convert [--compress] <text> <data>\n"
+              << "  datatool filter [--max-score cp] [--min-ply n] [--max-ply n] [--memory mb] [--compress]\n"
+              << "                  <output> <data>...\n";
+    return 1;
+}
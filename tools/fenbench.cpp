@@ -0,0 +1,107 @@
+// Compares the throughput of chess::Board::setFen with try_parse_fen, and
+// checks that both give the same boards (FEN and hash).
+//
+// Usage:
+//   fenbench <file> [repeats]
+//
+// The file holds one FEN per line; anything after a '|' is ignored, so text
+// training datasets can be used as they are.
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../src/fen.h"
+
+template <typename F>
+static double best_time(int repeats, F&& run) {
+    double best = 1e300;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+static void report(const char* name, std::size_t count, double seconds) {
+    std::cout << std::left << std::setw(14) << name << std::right
+              << std::setw(12) << count << " positions"
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << double(count) / seconds / 1e6 << " M/s"
+              << std::setw(10) << seconds * 1e9 / double(count) << " ns/position\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage:\n  fenbench <file> [repeats]\n";
+        return 1;
+    }
+    int repeats = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 3;
+
+    std::ifstream file(argv[1]);
+    if (!file) {
+        std::cerr << "Could not open " << argv[1] << "." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> fens;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('|'));
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            fens.push_back(line);
+        }
+    }
+
+    // Both loaders must agree before their speed means anything.
+    chess::Board expected;
+    chess::Board parsed;
+    std::size_t errors = 0;
+    std::size_t mismatches = 0;
+    for (const std::string& fen: fens) {
+        if (FenError error = try_parse_fen(parsed, fen); error != FenError::None) {
+            if (errors++ < 5) {
+                std::cerr << "error (" << fen_error_name(error) << "): " << fen << '\n';
+            }
+            continue;
+        }
+        expected.setFen(fen);
+        if (parsed.hash() != expected.hash() || parsed.getFen() != expected.getFen()) {
+            if (mismatches++ < 5) {
+                std::cerr << "mismatch: " << fen << "\n  setFen:        " << expected.getFen()
+                          << "\n  try_parse_fen: " << parsed.getFen() << '\n';
+            }
+        }
+    }
+
+    std::uint64_t checksum = 0;
+    double set_fen_time = best_time(repeats, [&] {
+        chess::Board board;
+        for (const std::string& fen: fens) {
+            board.setFen(fen);
+            checksum += board.hash();
+        }
+    });
+    double try_parse_time = best_time(repeats, [&] {
+        chess::Board board;
+        for (const std::string& fen: fens) {
+            (void)try_parse_fen(board, fen);
+            checksum += board.hash();
+        }
+    });
+
+    report("setFen", fens.size(), set_fen_time);
+    report("try_parse_fen", fens.size(), try_parse_time);
+    std::cout << "speedup " << std::setprecision(2) << set_fen_time / try_parse_time << "x, "
+              << errors << " errors, " << mismatches << " mismatches (checksum " << std::hex << checksum
+              << std::dec << ")" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+// Compares the throughput of chess::pgn::StreamParser reading through an
+// std::ifstream with PgnViewParser reading a memory-mapped file, on one
+// thread and split across several. Then compares replaying the games with
+// chess::uci::parseSan and with try_parse_san.
+//
+// Usage:
+//   pgnbench <pgn> [repeats] [threads]
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "../ext/chess/chess.h"
+#include "../src/mapped_file.h"
+#include "../src/pgn.h"
+#include "../src/san.h"
+
+// Counts what it is given, so that both parsers can be checked to agree
+// and the compiler can't skip any of the work.
+class CountingVisitor : public chess::pgn::Visitor {
+public:
+    std::uint64_t games = 0;
+    std::uint64_t headers = 0;
+    std::uint64_t moves = 0;
+    std::uint64_t bytes = 0;
+
+    void startPgn() override { games++; }
+    void header(std::string_view key, std::string_view value) override {
+        headers++;
+        bytes += key.size() + value.size();
+    }
+    void startMoves() override {}
+    void move(std::string_view move, std::string_view comment) override {
+        moves += !move.empty();
+        bytes += move.size();
+    }
+    void endPgn() override {}
+
+    // Bytes are left out, since escapes in header values are
+    // unescaped by StreamParser but passed as written when mapped.
+    bool operator==(const CountingVisitor& other) const {
+        return games == other.games && headers == other.headers && moves == other.moves;
+    }
+
+    void add(const CountingVisitor& other) {
+        games += other.games;
+        headers += other.headers;
+        moves += other.moves;
+        bytes += other.bytes;
+    }
+};
+
+// Plays through every game, decoding its moves with either SAN parser.
+template <bool TRY_PARSE>
+class ReplayVisitor : public chess::pgn::Visitor {
+public:
+    std::uint64_t moves = 0;
+    std::uint64_t errors = 0;
+    std::uint64_t checksum = 0;
+
+    void startPgn() override { m_board = chess::Board(); }
+    void header(std::string_view key, std::string_view value) override {
+        if (key == "FEN") {
+            m_board = chess::Board(value);
+        }
+    }
+    void startMoves() override {}
+    void move(std::string_view san, std::string_view comment) override {
+        if (san.empty()) {
+            return;
+        }
+
+        chess::Move move = chess::Move::NO_MOVE;
+        if constexpr (TRY_PARSE) {
+            if (try_parse_san(m_board, san, move, m_scratch) != SanError::None) {
+                errors++;
+                skipPgn(true);
+                return;
+            }
+        }
+        else {
+            try {
+                move = chess::uci::parseSan(m_board, san, m_scratch);
+            }
+            catch (const std::exception&) {
+                errors++;
+                skipPgn(true);
+                return;
+            }
+        }
+
+        moves++;
+        checksum = checksum * 31 + move.move();
+        m_board.makeMove(move);
+    }
+    void endPgn() override {}
+
+private:
+    chess::Board m_board;
+    chess::Movelist m_scratch;
+};
+
+template <typename F>
+static double best_time(int repeats, F&& run) {
+    double best = 1e300;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+static void report(const char* name, const CountingVisitor& counts, std::size_t size, double seconds) {
+    std::cout << std::left << std::setw(10) << name << std::right
+              << std::setw(12) << counts.games << " games"
+              << std::setw(14) << counts.moves << " moves"
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << double(size) / (1024 * 1024) / seconds << " MB/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage:\n  pgnbench <pgn> [repeats] [threads]\n";
+        return 1;
+    }
+    std::string path = argv[1];
+    int repeats = argc > 2 ? std::max(std::stoi(argv[2]), 1) : 3;
+    int threads = argc > 3 ? std::stoi(argv[3]) : int(std::thread::hardware_concurrency());
+
+    CountingVisitor stream_counts;
+    double stream_time = best_time(repeats, [&] {
+        stream_counts = {};
+        std::ifstream file(path, std::ios::binary);
+        chess::pgn::StreamParser parser(file);
+        parser.readGames(stream_counts);
+    });
+
+    CountingVisitor mapped_counts;
+    std::size_t size = 0;
+    double mapped_time = best_time(repeats, [&] {
+        mapped_counts = {};
+        MappedFile file(path);
+        size = file.size();
+        PgnViewParser parser(file.view());
+        parser.readGames(mapped_counts);
+    });
+
+    CountingVisitor parallel_counts;
+    double parallel_time = best_time(repeats, [&] {
+        parallel_counts = {};
+        MappedFile file(path);
+        parse_pgn_parallel<CountingVisitor>(
+            file.view(), threads,
+            [] { return std::make_unique<CountingVisitor>(); },
+            [&](std::unique_ptr<CountingVisitor> chunk) { parallel_counts.add(*chunk); });
+    });
+
+    report("istream", stream_counts, size, stream_time);
+    report("mmap", mapped_counts, size, mapped_time);
+    report("parallel", parallel_counts, size, parallel_time);
+    std::cout << "speedup " << std::setprecision(2) << stream_time / mapped_time << "x, "
+              << stream_time / parallel_time << "x with " << threads << " threads\n";
+
+    MappedFile file(path);
+    auto replay = [&](const char* name, auto& visitor) {
+        double seconds = best_time(repeats, [&] {
+            visitor = {};
+            PgnViewParser parser(file.view());
+            parser.readGames(visitor);
+        });
+        std::cout << std::left << std::setw(10) << name << std::right
+                  << std::setw(14) << visitor.moves << " moves"
+                  << std::setw(8) << visitor.errors << " errors"
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(10) << double(visitor.moves) / seconds / 1e6 << " M moves/s\n";
+        return seconds;
+    };
+    ReplayVisitor<false> san_replay;
+    ReplayVisitor<true> try_replay;
+    double san_time = replay("parseSan", san_replay);
+    double try_time = replay("tryParse", try_replay);
+    std::cout << "speedup " << std::setprecision(2) << san_time / try_time << "x\n";
+
+    if (san_replay.checksum != try_replay.checksum || san_replay.moves != try_replay.moves) {
+        std::cerr << "warning: the SAN parsers disagree on this file." << std::endl;
+        return 2;
+    }
+    if (!(stream_counts == mapped_counts) || !(stream_counts == parallel_counts)) {
+        std::cerr << "warning: the parsers disagree on this file." << std::endl;
+        return 2;
+    }
+    return 0;
+}
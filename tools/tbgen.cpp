@@ -0,0 +1,336 @@
+// Generates the win/draw/loss tables of src/tablebase.h by retrograde
+// analysis, for every material with up to 4 pieces (or max_pieces).
+//
+// Usage:
+//   tbgen <directory> [max_pieces]
+//
+// Tables already in the directory are kept, so an interrupted run can be
+// resumed. Each table only needs the ones generated before it.
+//
+// Every position is first set up on a chess::Board and its legal moves are
+// generated: mates and stalemates are decided, captures and promotions are
+// looked up in the smaller tables, and the distinct positions the other
+// moves lead to are counted. Decided positions are then propagated back to
+// their predecessors, found by unmaking moves: a loss makes them wins, and
+// a win decrements their count, making them losses once every move is
+// known to lose. Whatever is left undecided is a draw.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../src/tablebase.h"
+
+using namespace chess;
+
+namespace {
+
+enum State : std::uint8_t {
+    UNKNOWN,
+    WIN,
+    LOSS,
+    DRAW,
+    UNUSED,
+};
+
+// Set as the count of positions that can't be lost, having a drawing capture
+// or promotion.
+constexpr std::uint8_t CANNOT_LOSE = 255;
+
+// A board whose pieces can be replaced with those of a TbPosition without
+// going through a FEN.
+class TbBoard : public Board {
+public:
+    TbBoard()
+        : Board("4k3/8/8/8/8/8/8/4K3 w - - 0 1") {
+        m_position.count = 2;
+        m_position.pieces[0] = Piece(PieceType::KING, Color::WHITE);
+        m_position.pieces[1] = Piece(PieceType::KING, Color::BLACK);
+        m_position.squares[0] = 4;
+        m_position.squares[1] = 60;
+    }
+
+    void set(const TbPosition& position) {
+        for (int i = 0; i < m_position.count; ++i) {
+            removePiece(m_position.pieces[i], Square(m_position.squares[i]));
+        }
+        for (int i = 0; i < position.count; ++i) {
+            placePiece(position.pieces[i], Square(position.squares[i]));
+        }
+        stm_ = position.side_to_move;
+        m_position = position;
+    }
+
+private:
+    TbPosition m_position;
+};
+
+}
+
+static std::uint64_t occupancy(const TbPosition& position) {
+    std::uint64_t occupied = 0;
+    for (int i = 0; i < position.count; ++i) {
+        occupied |= 1ull << position.squares[i];
+    }
+    return occupied;
+}
+
+static bool attacked(const TbPosition& position, int square, Color by) {
+    Bitboard occupied(occupancy(position));
+    Bitboard target(1ull << square);
+    for (int i = 0; i < position.count; ++i) {
+        Piece piece = position.pieces[i];
+        if (piece.color() != by) {
+            continue;
+        }
+        Square from(position.squares[i]);
+        Bitboard attacks;
+        switch (int(piece.type())) {
+            case int(PieceType::PAWN):   attacks = attacks::pawn(by, from); break;
+            case int(PieceType::KNIGHT): attacks = attacks::knight(from); break;
+            case int(PieceType::BISHOP): attacks = attacks::bishop(from, occupied); break;
+            case int(PieceType::ROOK):   attacks = attacks::rook(from, occupied); break;
+            case int(PieceType::QUEEN):  attacks = attacks::queen(from, occupied); break;
+            default:                     attacks = attacks::king(from); break;
+        }
+        if (attacks & target) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int king_square(const TbPosition& position, Color color) {
+    for (int i = 0; i < position.count; ++i) {
+        if (position.pieces[i] == Piece(PieceType::KING, color)) {
+            return position.squares[i];
+        }
+    }
+    return -1;
+}
+
+// Sorts and removes duplicates, returning the new size.
+static int unique_indices(std::vector<std::uint64_t>& indices) {
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    return int(indices.size());
+}
+
+// The indices of the positions from which a quiet move (not a capture or a
+// promotion) leads to this one.
+static void predecessors(const TbLayout& layout, const TbPosition& position, std::vector<std::uint64_t>& indices) {
+    indices.clear();
+    Color mover = ~position.side_to_move;
+    std::uint64_t occupied = occupancy(position);
+
+    for (int i = 0; i < position.count; ++i) {
+        Piece piece = position.pieces[i];
+        if (piece.color() != mover) {
+            continue;
+        }
+        int to = position.squares[i];
+        Square square(to);
+        std::uint64_t from_squares = 0;
+        switch (int(piece.type())) {
+            case int(PieceType::PAWN): {
+                int back = mover == Color::WHITE ? -8 : 8;
+                int rank = mover == Color::WHITE ? to >> 3 : 7 - (to >> 3);
+                // A pawn on its second rank can't have moved.
+                if (rank >= 2 && !(occupied >> (to + back) & 1)) {
+                    from_squares |= 1ull << (to + back);
+                    if (rank == 3 && !(occupied >> (to + 2 * back) & 1)) {
+                        from_squares |= 1ull << (to + 2 * back);
+                    }
+                }
+                break;
+            }
+            case int(PieceType::KNIGHT): from_squares = attacks::knight(square).getBits(); break;
+            case int(PieceType::BISHOP): from_squares = attacks::bishop(square, Bitboard(occupied)).getBits(); break;
+            case int(PieceType::ROOK):   from_squares = attacks::rook(square, Bitboard(occupied)).getBits(); break;
+            case int(PieceType::QUEEN):  from_squares = attacks::queen(square, Bitboard(occupied)).getBits(); break;
+            default:                     from_squares = attacks::king(square).getBits(); break;
+        }
+        from_squares &= ~occupied;
+
+        while (from_squares) {
+            int from = __builtin_ctzll(from_squares);
+            from_squares &= from_squares - 1;
+
+            TbPosition previous = position;
+            previous.squares[i] = std::uint8_t(from);
+            previous.side_to_move = mover;
+            // The side that didn't move can't have been left in check.
+            if (attacked(previous, king_square(previous, position.side_to_move), mover)) {
+                continue;
+            }
+            indices.push_back(layout.index(previous));
+        }
+    }
+    unique_indices(indices);
+}
+
+// The position after a move, with the captured piece removed.
+static TbPosition play(const TbPosition& position, Move move) {
+    TbPosition next = position;
+    int from = move.from().index();
+    int to = move.to().index();
+    for (int i = 0; i < next.count; ++i) {
+        if (next.squares[i] == to) {
+            next.pieces[i] = next.pieces[next.count - 1];
+            next.squares[i] = next.squares[next.count - 1];
+            next.count--;
+            break;
+        }
+    }
+    for (int i = 0; i < next.count; ++i) {
+        if (next.squares[i] == from) {
+            next.squares[i] = std::uint8_t(to);
+            if (move.typeOf() == Move::PROMOTION) {
+                next.pieces[i] = Piece(move.promotionType(), position.side_to_move);
+            }
+            break;
+        }
+    }
+    next.side_to_move = ~position.side_to_move;
+    return next;
+}
+
+static std::vector<Wdl> generate(const TbLayout& layout, const Tablebases& smaller) {
+    std::uint64_t entries = layout.entry_count();
+    std::vector<std::uint8_t> states(entries, UNKNOWN);
+    std::vector<std::uint8_t> counts(entries, 0);
+    // Entries fit in 32 bits up to 4 pieces.
+    std::vector<std::uint32_t> decided;
+    std::vector<std::uint64_t> children;
+
+    TbBoard board;
+    TbPosition position;
+    Movelist moves;
+    for (std::uint64_t index = 0; index < entries; ++index) {
+        if (!layout.decode(index, position)
+            || attacked(position, king_square(position, ~position.side_to_move), position.side_to_move)) {
+            states[index] = UNUSED;
+            continue;
+        }
+        board.set(position);
+        movegen::legalmoves(moves, board);
+        if (moves.empty()) {
+            states[index] = board.inCheck() ? LOSS : DRAW;
+            if (states[index] == LOSS) {
+                decided.push_back(std::uint32_t(index));
+            }
+            continue;
+        }
+
+        bool can_lose = true;
+        children.clear();
+        for (const Move& move: moves) {
+            TbPosition next = play(position, move);
+            if (next.count == position.count && move.typeOf() != Move::PROMOTION) {
+                children.push_back(layout.index(next));
+                continue;
+            }
+            std::optional<Wdl> result = smaller.probe(next);
+            if (!result) {
+                throw std::runtime_error("Missing table for a capture or promotion from " + layout.name() + ".");
+            }
+            if (*result == Wdl::Loss) {
+                states[index] = WIN;
+                break;
+            }
+            can_lose &= *result != Wdl::Draw;
+        }
+        if (states[index] == WIN) {
+            decided.push_back(std::uint32_t(index));
+            continue;
+        }
+
+        int count = unique_indices(children);
+        if (count == 0) {
+            states[index] = can_lose ? LOSS : DRAW;
+            if (can_lose) {
+                decided.push_back(std::uint32_t(index));
+            }
+            continue;
+        }
+        counts[index] = can_lose ? std::uint8_t(count) : CANNOT_LOSE;
+    }
+
+    // Each decided position is propagated once, so each of its distinct
+    // predecessors is decremented once, matching the distinct children
+    // counted above.
+    std::vector<std::uint64_t> previous;
+    for (std::size_t i = 0; i < decided.size(); ++i) {
+        std::uint64_t index = decided[i];
+        bool loss = states[index] == LOSS;
+        layout.decode(index, position);
+        predecessors(layout, position, previous);
+        for (std::uint64_t p: previous) {
+            if (states[p] != UNKNOWN) {
+                continue;
+            }
+            if (loss) {
+                states[p] = WIN;
+                decided.push_back(std::uint32_t(p));
+            }
+            else if (counts[p] != CANNOT_LOSE && --counts[p] == 0) {
+                states[p] = LOSS;
+                decided.push_back(std::uint32_t(p));
+            }
+        }
+    }
+
+    std::vector<Wdl> results(entries, Wdl::Draw);
+    for (std::uint64_t index = 0; index < entries; ++index) {
+        results[index] = states[index] == WIN ? Wdl::Win : states[index] == LOSS ? Wdl::Loss : Wdl::Draw;
+    }
+    return results;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage:\n  tbgen <directory> [max_pieces]\n";
+        return 1;
+    }
+    std::string directory = argv[1];
+    int max_pieces = argc > 2 ? std::min(std::stoi(argv[2]), TB_MAX_PIECES) : TB_MAX_PIECES;
+
+    try {
+        Tablebases tablebases;
+        tablebases.open(directory);
+        for (const std::string& name: tablebase_names(max_pieces)) {
+            std::string path = directory + "/" + name + ".wdl";
+            if (std::ifstream(path)) {
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            TbLayout layout(name);
+            std::vector<Wdl> results = generate(layout, tablebases);
+            write_tablebase(path, layout, results);
+            tablebases.open(directory);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            // Counted over the indices, where symmetric positions count once.
+            std::uint64_t counts[3] = {};
+            for (Wdl result: results) {
+                counts[int(result) + 1]++;
+            }
+            std::cout << std::left << std::setw(8) << name << std::right
+                      << std::setw(12) << layout.entry_count() << " entries"
+                      << std::setw(12) << counts[2] << " wins"
+                      << std::setw(12) << counts[0] << " losses"
+                      << std::fixed << std::setprecision(1) << std::setw(8) << seconds << " s" << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
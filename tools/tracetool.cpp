@@ -0,0 +1,195 @@
+// Summarizes and compares search traces recorded by ENGINE_TRACE builds.
+//
+// Usage:
+//   tracetool summary <trace>
+//   tracetool diff <trace-a> <trace-b>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../src/trace.h"
+
+struct Trace {
+    TraceHeader header {};
+    // Stored records, oldest first.
+    std::vector<TraceRecord> records;
+
+    [[nodiscard]] bool wrapped() const { return header.written > header.capacity; }
+};
+
+static bool load_trace(const std::string& path, Trace& trace) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char*>(&trace.header), sizeof(TraceHeader))) {
+        std::cerr << path << ": could not read header." << std::endl;
+        return false;
+    }
+    if (std::memcmp(trace.header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0
+        || trace.header.version != TRACE_VERSION
+        || trace.header.record_size != sizeof(TraceRecord)) {
+        std::cerr << path << ": not a trace file of a compatible version." << std::endl;
+        return false;
+    }
+
+    std::uint64_t stored = std::min(trace.header.written, trace.header.capacity);
+    std::vector<TraceRecord> ring(stored);
+    if (!file.read(reinterpret_cast<char*>(ring.data()), std::streamsize(stored * sizeof(TraceRecord)))) {
+        std::cerr << path << ": trace is truncated." << std::endl;
+        return false;
+    }
+
+    // Once wrapped, the oldest record sits right after the newest one.
+    std::uint64_t oldest = trace.wrapped() ? trace.header.written % trace.header.capacity : 0;
+    trace.records.reserve(stored);
+    for (std::uint64_t i = 0; i < stored; ++i) {
+        trace.records.push_back(ring[(oldest + i) % stored]);
+    }
+    return true;
+}
+
+static std::ostream& operator<<(std::ostream& stream, const TraceRecord& r) {
+    return stream << "thread " << int(r.thread)
+                  << " depth " << int(r.depth)
+                  << " move " << chess::Move(r.move)
+                  << " alpha " << r.alpha
+                  << " beta " << r.beta
+                  << " result " << r.result
+                  << " hash " << std::hex << std::setw(16) << std::setfill('0') << r.hash
+                  << std::dec << std::setfill(' ');
+}
+
+static bool same_record(const TraceRecord& a, const TraceRecord& b) {
+    return a.hash == b.hash && a.result == b.result && a.alpha == b.alpha
+        && a.beta == b.beta && a.move == b.move && a.depth == b.depth;
+}
+
+// Records of each thread, in the order the thread wrote them.
+static std::map<int, std::vector<TraceRecord>> split_by_thread(const Trace& trace) {
+    std::map<int, std::vector<TraceRecord>> threads;
+    for (const TraceRecord& r: trace.records) {
+        threads[r.thread].push_back(r);
+    }
+    return threads;
+}
+
+static std::map<int, std::uint64_t> nodes_per_depth(const Trace& trace) {
+    std::map<int, std::uint64_t> depths;
+    for (const TraceRecord& r: trace.records) {
+        depths[r.depth]++;
+    }
+    return depths;
+}
+
+static int summary(const std::string& path) {
+    Trace trace;
+    if (!load_trace(path, trace)) {
+        return 1;
+    }
+
+    std::cout << "records written " << trace.header.written
+              << ", stored " << trace.records.size()
+              << (trace.wrapped() ? " (ring wrapped, oldest records lost)" : "") << '\n';
+
+    std::cout << "\nthread       nodes\n";
+    for (const auto& [thread, records]: split_by_thread(trace)) {
+        std::cout << std::setw(6) << thread << std::setw(12) << records.size() << '\n';
+    }
+
+    std::cout << "\n depth       nodes\n";
+    for (const auto& [depth, count]: nodes_per_depth(trace)) {
+        std::cout << std::setw(6) << depth << std::setw(12) << count << '\n';
+    }
+    return 0;
+}
+
+static int diff(const std::string& path_a, const std::string& path_b) {
+    Trace a, b;
+    if (!load_trace(path_a, a) || !load_trace(path_b, b)) {
+        return 1;
+    }
+    if (a.wrapped() || b.wrapped()) {
+        std::cout << "warning: a trace wrapped around, record positions may not line up.\n";
+    }
+
+    std::cout << "records " << a.header.written << " vs " << b.header.written << '\n';
+
+    std::cout << "\n depth           a           b        diff\n";
+    std::map<int, std::uint64_t> depths_a = nodes_per_depth(a);
+    std::map<int, std::uint64_t> depths_b = nodes_per_depth(b);
+    std::map<int, bool> all_depths;
+    for (const auto& pair: depths_a) all_depths[pair.first] = true;
+    for (const auto& pair: depths_b) all_depths[pair.first] = true;
+    for (const auto& pair: all_depths) {
+        std::int64_t na = std::int64_t(depths_a[pair.first]);
+        std::int64_t nb = std::int64_t(depths_b[pair.first]);
+        std::cout << std::setw(6) << pair.first << std::setw(12) << na << std::setw(12) << nb
+                  << std::setw(12) << std::showpos << nb - na << std::noshowpos << '\n';
+    }
+
+    // Children are recorded before their parents, so the first differing record
+    // of a thread is the deepest point where the two searches stopped agreeing.
+    auto threads_a = split_by_thread(a);
+    auto threads_b = split_by_thread(b);
+    std::map<int, bool> all_threads;
+    for (const auto& pair: threads_a) all_threads[pair.first] = true;
+    for (const auto& pair: threads_b) all_threads[pair.first] = true;
+
+    bool identical = true;
+    for (const auto& pair: all_threads) {
+        int thread = pair.first;
+        auto found_a = threads_a.find(thread);
+        auto found_b = threads_b.find(thread);
+        if (found_a == threads_a.end() || found_b == threads_b.end()) {
+            identical = false;
+            bool in_a = found_a != threads_a.end();
+            std::cout << "\nthread " << thread << " only in " << (in_a ? 'a' : 'b') << ", "
+                      << (in_a ? found_a : found_b)->second.size() << " records\n";
+            continue;
+        }
+
+        const std::vector<TraceRecord>& records_a = found_a->second;
+        const std::vector<TraceRecord>& records_b = found_b->second;
+        std::size_t n = std::min(records_a.size(), records_b.size());
+        std::size_t i = 0;
+        while (i < n && same_record(records_a[i], records_b[i])) {
+            ++i;
+        }
+        if (i == n && records_a.size() == records_b.size()) {
+            continue;
+        }
+
+        identical = false;
+        std::cout << "\nthread " << thread << " diverges at record " << i << ":\n";
+        std::size_t context = i >= 3 ? i - 3 : 0;
+        for (std::size_t j = context; j < i; ++j) {
+            std::cout << "    " << records_a[j] << '\n';
+        }
+        std::cout << "  a " << (i < records_a.size() ? records_a[i] : TraceRecord {}) << '\n'
+                  << "  b " << (i < records_b.size() ? records_b[i] : TraceRecord {}) << '\n';
+    }
+
+    if (identical) {
+        std::cout << "\ntraces are identical.\n";
+    }
+    return identical ? 0 : 2;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && argv[1] == std::string("summary")) {
+        return summary(argv[2]);
+    }
+    if (argc == 4 && argv[1] == std::string("diff")) {
+        return diff(argv[2], argv[3]);
+    }
+
+    std::cerr << "Usage:\n"
+              << "  tracetool summary <trace>\n"
+              << "  tracetool diff <trace-a> <trace-b>\n";
+    return 1;
+}
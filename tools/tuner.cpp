@@ -0,0 +1,353 @@
+// Tunes the evaluation parameters (src/eval.h) on positions with known
+// outcomes, Texel style: the evaluation, passed through a sigmoid, should
+// predict the game result. Since the evaluation is linear in its parameters,
+// the features of every position are extracted once into a compact array,
+// and the parameters are then fitted by multithreaded Adam on the mean
+// squared error, without ever running the evaluation again.
+//
+// Usage:
+//   tuner [options] <data>...
+//
+// Options:
+//   --epochs <n>       Optimization steps (default 500).
+//   --rate <r>         Adam learning rate, in centipawns (default 1.0).
+//   --lambda <l>       Weight of the result in the target, from 0 to 1, the rest being the
+//                      sigmoid of the recorded search score (default 1.0).
+//   --k <k>            Sigmoid scale; fitted to the data if not given.
+//   --threads <n>      Worker threads (default: all cores).
+//   --output <file>    Where to write the tuned parameters (default tuned.txt).
+//
+// The output file holds the parameters as a C++ initializer for EvalParams.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ext/chess/chess.h"
+#include "../src/eval.h"
+#include "../src/trainingdata.h"
+
+struct Options {
+    int epochs = 500;
+    double rate = 1.0;
+    double lambda = 1.0;
+    double k = 0;
+    int threads = int(std::max(std::thread::hardware_concurrency(), 1u));
+    std::string output = "tuned.txt";
+    std::vector<std::string> inputs;
+};
+
+// A position, reduced to what the loss needs. Its features are
+// features[begin, begin + count) of the dataset.
+struct TuneEntry {
+    std::uint32_t begin;
+    std::uint16_t count;
+    std::uint8_t phase;
+    // Expected score for white, from 0 to 1.
+    float target;
+    // Search score for white, used when blending the target.
+    std::int16_t score;
+};
+
+struct Dataset {
+    std::vector<TuneEntry> entries;
+    std::vector<EvalFeature> features;
+};
+
+static Dataset load_dataset(const Options& options) {
+    Dataset data;
+    std::vector<EvalFeature> features;
+    TrainingRecord record {};
+
+    for (const std::string& input: options.inputs) {
+        TrainingReader reader(input);
+        data.entries.reserve(data.entries.size() + reader.record_count());
+        while (reader.next(record)) {
+            chess::Board board = chess::Board::Compact::decode(record.board);
+            bool white = board.sideToMove() == chess::Color::WHITE;
+            eval_features(board, features);
+
+            TuneEntry entry {};
+            entry.begin = std::uint32_t(data.features.size());
+            entry.count = std::uint16_t(features.size());
+            entry.phase = std::uint8_t(eval_phase(board));
+            entry.target = float(((white ? record.result : -record.result) + 1) / 2.0);
+            entry.score = std::int16_t(white ? record.score : -record.score);
+            data.entries.push_back(entry);
+            data.features.insert(data.features.end(), features.begin(), features.end());
+        }
+    }
+    return data;
+}
+
+// Parameters as doubles, middlegame values first, then endgame ones.
+using Weights = std::vector<double>;
+
+static double linear_eval(const Dataset& data, const TuneEntry& entry, const Weights& weights) {
+    double mg = 0;
+    double eg = 0;
+    for (std::uint32_t i = entry.begin; i < entry.begin + entry.count; ++i) {
+        const EvalFeature& f = data.features[i];
+        mg += f.coefficient * weights[f.index];
+        eg += f.coefficient * weights[EVAL_PARAM_COUNT + f.index];
+    }
+    return (mg * entry.phase + eg * (EVAL_PHASE_MAX - entry.phase)) / EVAL_PHASE_MAX;
+}
+
+static double sigmoid(double k, double score) {
+    return 1.0 / (1.0 + std::exp(-k * score / 400.0));
+}
+
+static double target(const TuneEntry& entry, double k, double lambda) {
+    return lambda * entry.target + (1 - lambda) * sigmoid(k, entry.score);
+}
+
+// Runs work(begin, end, thread) over the entries split evenly between threads.
+template <typename Work>
+static void parallel_for(std::size_t count, int threads, Work work) {
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        std::size_t begin = count * t / threads;
+        std::size_t end = count * (t + 1) / threads;
+        workers.emplace_back(work, begin, end, t);
+    }
+    for (std::thread& w: workers) {
+        w.join();
+    }
+}
+
+static double mean_error(const Dataset& data, const Weights& weights, double k, double lambda, int threads) {
+    std::vector<double> sums(threads);
+    parallel_for(data.entries.size(), threads, [&](std::size_t begin, std::size_t end, int t) {
+        double sum = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const TuneEntry& entry = data.entries[i];
+            double error = target(entry, k, lambda) - sigmoid(k, linear_eval(data, entry, weights));
+            sum += error * error;
+        }
+        sums[t] = sum;
+    });
+
+    double sum = 0;
+    for (double s: sums) {
+        sum += s;
+    }
+    return sum / double(std::max<std::size_t>(data.entries.size(), 1));
+}
+
+// Scale of the sigmoid that best fits the results with the current
+// parameters, found by narrowing down a bracket around the minimum.
+static double fit_k(const Dataset& data, const Weights& weights, double lambda, int threads) {
+    double low = 0.1;
+    double high = 10;
+    for (int i = 0; i < 40; ++i) {
+        double a = low + (high - low) / 3;
+        double b = high - (high - low) / 3;
+        if (mean_error(data, weights, a, lambda, threads) < mean_error(data, weights, b, lambda, threads)) {
+            high = b;
+        }
+        else {
+            low = a;
+        }
+    }
+    return (low + high) / 2;
+}
+
+static void gradient(const Dataset& data, const Weights& weights, double k, double lambda, int threads,
+                     Weights& result) {
+    std::vector<Weights> partial(threads, Weights(weights.size()));
+    parallel_for(data.entries.size(), threads, [&](std::size_t begin, std::size_t end, int t) {
+        Weights& g = partial[t];
+        for (std::size_t i = begin; i < end; ++i) {
+            const TuneEntry& entry = data.entries[i];
+            double s = sigmoid(k, linear_eval(data, entry, weights));
+            // Derivative of the squared error with respect to the evaluation.
+            double d = (s - target(entry, k, lambda)) * s * (1 - s);
+            double mg = d * entry.phase / EVAL_PHASE_MAX;
+            double eg = d * (EVAL_PHASE_MAX - entry.phase) / EVAL_PHASE_MAX;
+            for (std::uint32_t j = entry.begin; j < entry.begin + entry.count; ++j) {
+                const EvalFeature& f = data.features[j];
+                g[f.index] += mg * f.coefficient;
+                g[EVAL_PARAM_COUNT + f.index] += eg * f.coefficient;
+            }
+        }
+    });
+
+    std::fill(result.begin(), result.end(), 0.0);
+    for (const Weights& g: partial) {
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            result[i] += g[i];
+        }
+    }
+}
+
+static void write_params(const std::string& path, const Weights& weights) {
+    std::ofstream out(path);
+    auto write_array = [&](int offset) {
+        out << "    {";
+        for (int i = 0; i < EVAL_PARAM_COUNT; ++i) {
+            out << (i % 16 == 0 ? "\n        " : " ") << std::lround(weights[offset + i]) << ",";
+        }
+        out << "\n    },\n";
+    };
+    out << "// Tuned EvalParams: middlegame values, then endgame values.\n{\n";
+    write_array(0);
+    write_array(EVAL_PARAM_COUNT);
+    out << "}\n";
+    if (!out) {
+        throw std::runtime_error("Could not write " + path + ".");
+    }
+}
+
+// Parses an option value in [min, max]. Throws std::invalid_argument
+// naming the option otherwise.
+static double parse_number(const std::string& name, const std::string& value, double min, double max) {
+    double number = 0;
+    std::size_t end = 0;
+    try {
+        number = std::stod(value, &end);
+    }
+    catch (const std::exception&) {
+        end = 0;
+    }
+    if (end == 0 || end != value.size() || !(number >= min && number <= max)) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value + ".");
+    }
+    return number;
+}
+
+static int parse_integer(const std::string& name, const std::string& value, int min, int max) {
+    double number = parse_number(name, value, min, max);
+    if (number != std::floor(number)) {
+        throw std::invalid_argument("Invalid value for " + name + ": " + value + ".");
+    }
+    return int(number);
+}
+
+// Returns false on a usage error. Throws std::invalid_argument on invalid
+// option values.
+static bool parse_options(int argc, char* argv[], Options& options) {
+    int i = 1;
+    for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; i += 2) {
+        std::string name = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[i + 1];
+        if (name == "--epochs") {
+            options.epochs = parse_integer(name, value, 1, 1000000000);
+        }
+        else if (name == "--rate") {
+            options.rate = parse_number(name, value, 0, 1e6);
+        }
+        else if (name == "--lambda") {
+            options.lambda = parse_number(name, value, 0, 1);
+        }
+        else if (name == "--k") {
+            options.k = parse_number(name, value, 0, 1e6);
+        }
+        else if (name == "--threads") {
+            options.threads = parse_integer(name, value, 1, 1024);
+        }
+        else if (name == "--output") {
+            options.output = value;
+        }
+        else {
+            return false;
+        }
+    }
+    options.inputs.assign(argv + i, argv + argc);
+    return !options.inputs.empty();
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    bool parsed = false;
+    try {
+        parsed = parse_options(argc, argv, options);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+    }
+    if (!parsed) {
+        std::cerr << "Usage:\n"
+                  << "  tuner [--epochs n] [--rate r] [--lambda l] [--k k] [--threads n] [--output file] <data>...\n";
+        return 1;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        Dataset data = load_dataset(options);
+        double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << data.entries.size() << " positions, " << data.features.size() << " features loaded in "
+                  << load_seconds << " s ("
+                  << (data.entries.size() * sizeof(TuneEntry) + data.features.size() * sizeof(EvalFeature)) / (1024 * 1024)
+                  << " MiB)" << std::endl;
+        if (data.entries.empty()) {
+            throw std::runtime_error("No positions to tune on.");
+        }
+        // Every thread gets at least one position.
+        options.threads = int(std::min<std::size_t>(options.threads, data.entries.size()));
+
+        Weights weights(2 * EVAL_PARAM_COUNT);
+        for (int i = 0; i < EVAL_PARAM_COUNT; ++i) {
+            weights[i] = DEFAULT_EVAL_PARAMS.mg[i];
+            weights[EVAL_PARAM_COUNT + i] = DEFAULT_EVAL_PARAMS.eg[i];
+        }
+
+        double k = options.k > 0 ? options.k : fit_k(data, weights, options.lambda, options.threads);
+        std::cout << "k " << k << ", initial error " << std::setprecision(8)
+                  << mean_error(data, weights, k, options.lambda, options.threads) << std::endl;
+
+        // Adam, with the usual decay rates.
+        constexpr double BETA1 = 0.9;
+        constexpr double BETA2 = 0.999;
+        constexpr double EPSILON = 1e-8;
+        Weights grad(weights.size());
+        Weights m(weights.size());
+        Weights v(weights.size());
+
+        start = std::chrono::steady_clock::now();
+        for (int epoch = 1; epoch <= options.epochs; ++epoch) {
+            gradient(data, weights, k, options.lambda, options.threads, grad);
+            for (std::size_t i = 0; i < weights.size(); ++i) {
+                m[i] = BETA1 * m[i] + (1 - BETA1) * grad[i];
+                v[i] = BETA2 * v[i] + (1 - BETA2) * grad[i] * grad[i];
+                double m_hat = m[i] / (1 - std::pow(BETA1, epoch));
+                double v_hat = v[i] / (1 - std::pow(BETA2, epoch));
+                weights[i] -= options.rate * m_hat / (std::sqrt(v_hat) + EPSILON);
+            }
+
+            if (epoch % 50 == 0 || epoch == options.epochs) {
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::cout << "epoch " << epoch << " error "
+                          << mean_error(data, weights, k, options.lambda, options.threads)
+                          << " (" << seconds / epoch * 1000 << " ms/epoch)" << std::endl;
+            }
+        }
+
+        write_params(options.output, weights);
+        std::cout << "material mg";
+        for (int pt = 0; pt < 5; ++pt) {
+            std::cout << ' ' << std::lround(weights[PARAM_MATERIAL + pt]);
+        }
+        std::cout << " eg";
+        for (int pt = 0; pt < 5; ++pt) {
+            std::cout << ' ' << std::lround(weights[EVAL_PARAM_COUNT + PARAM_MATERIAL + pt]);
+        }
+        std::cout << "\nparameters written to " << options.output << std::endl;
+        return 0;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}